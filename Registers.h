@@ -16,5 +16,9 @@ extern void startRtosAssembly(uint32_t stack_ptr);
 extern uint32_t moveToRegisterR0(void);
 extern void moveToRegisterR0WithValue(uint32_t value);
 extern uint32_t readSvcPriority(void);
+extern void *atomicPop(void **head);
+extern void atomicPush(void **head, void *block);
+extern uint32_t atomicAdd(uint32_t *value, int32_t delta);
+extern void writeMpuRegions(const uint32_t *bases, const uint32_t *attrs);
 extern void* SVCmallocFromHeap(uint32_t size_in_bytes);
 #endif
@@ -14,6 +14,12 @@
 	.def moveToRegisterR0
 	.def readSvcPriority
 	.def moveToRegisterR0WithValue
+	.def atomicPop
+	.def atomicPush
+	.def atomicAdd
+	.def writeMpuRegions
+	.def pendSvIsr
+	.ref pendSvSwitch
 
 
 
@@ -80,3 +86,69 @@ readSvcPriority:
     LDRB R0, [R0, #-2]  ; Get the value of the argument from the location before the return address pointing to
     BX  LR              ; Return
 
+
+
+; Lock-free stack of memory blocks; the first word of each free block links to the next
+; STREX fails if anything else stored to the head or an exception was taken since the
+; LDREX, so a block cannot be popped twice and the head cannot go back in time (ABA)
+atomicPop:                   ; R0 = address of the head, returns the popped block or 0
+    LDREX R1, [R0]           ; Load the head and claim the monitor
+    CBZ R1, atomicPopEmpty   ; Empty stack
+    LDR R2, [R1]             ; Block that becomes the new head
+    STREX R3, R2, [R0]       ; Store it only if the head is unchanged
+    CMP R3, #0
+    BNE atomicPop            ; Interrupted, try again
+    MOV R0, R1
+    BX LR
+atomicPopEmpty:
+    CLREX                    ; Release the monitor
+    MOV R0, #0
+    BX LR
+
+atomicPush:                  ; R0 = address of the head, R1 = block to push
+    LDREX R2, [R0]           ; Load the head and claim the monitor
+    STR R2, [R1]             ; Link the block to the current head
+    STREX R3, R1, [R0]       ; Make it the head only if the head is unchanged
+    CMP R3, #0
+    BNE atomicPush           ; Interrupted, try again
+    BX LR
+
+atomicAdd:                   ; R0 = address of a word, R1 = value to add, returns the new value
+    LDREX R2, [R0]
+    ADD R2, R2, R1
+    STREX R3, R2, [R0]
+    CMP R3, #0
+    BNE atomicAdd            ; Interrupted, try again
+    MOV R0, R2
+    BX LR
+
+; Program the five heap MPU regions (3-7) from RBAR and RASR tables
+; MPU_BASE/MPU_ATTR and their three aliases are consecutive, so one 8 word store
+; writes four regions (RBAR carries VALID and the region number) and a second
+; store writes the fifth
+writeMpuRegions:             ; R0 = 5 RBAR values, R1 = 5 RASR values
+    PUSH {R4-R9}
+    MOVW R12, #0xED9C
+    MOVT R12, #0xE000        ; MPU_BASE
+    LDMIA R0!, {R2, R4, R6, R8}
+    LDMIA R1!, {R3, R5, R7, R9}
+    STMIA R12, {R2-R9}       ; Regions 3-6 in one burst
+    LDR R2, [R0]
+    LDR R3, [R1]
+    STMIA R12, {R2, R3}      ; Region 7
+    DSB                      ; New attributes apply before returning to a task
+    POP {R4-R9}
+    BX LR
+
+; PendSV handler: save R4-R11 and EXC_RETURN of the outgoing task below its
+; hardware frame, let pendSvSwitch() pick the next task and load its PSP, then
+; restore the incoming task's registers from below its frame
+; Written here so no compiler-saved register can be live across the switch
+pendSvIsr:
+    MRS R0, PSP
+    STMDB R0, {R4-R11, LR}   ; Store R4-R11 and LR below the outgoing frame
+    BL pendSvSwitch          ; Returns with PSP set to the incoming task
+    MRS R1, PSP
+    SUBS R1, #0x24           ; Go down 9 registers and pop from there
+    LDMIA R1!, {R4-R11, LR}  ; Load R4-R11 and EXC_RETURN of the incoming task
+    BX LR
@@ -0,0 +1,482 @@
+// Heap allocator benchmark
+// Compares mallocFromHeap() in heap.c with the allocator it replaced (the
+// per-size allocation() probes over a byte per subregion, kept below verbatim)
+// on allocation time and on failures caused by fragmentation
+
+// Runs on the host, not the target. From the project directory:
+//   gcc -std=c99 -O2 -I. -o heapbench bench/heapbench.c heap.c
+//   ./heapbench
+// Add -DHEAP_BUDDY to measure the buddy allocator instead of the bitmap one
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mm.h"
+
+#define BENCH_LIVE 16               // most allocations held at once
+#define BENCH_STEPS 1000000         // random allocate/free steps per allocator
+#define BENCH_ROUNDS 200000         // timed fill-and-empty rounds per allocator
+
+//-----------------------------------------------------------------------------
+// Previous allocator
+//-----------------------------------------------------------------------------
+
+#define BLOCK_SIZE_512     512
+#define BLOCK_SIZE_1024    1024
+#define BLOCK_SIZE_1536    1536
+
+// Base addresses for each memory region
+
+#define REGION_4K0_BASE_ADDR    0x20000000
+#define REGION_4K1_BASE_ADDR    0x20001000
+#define REGION_8K1_BASE_ADDR    0x20002000
+#define REGION_4K2_BASE_ADDR    0x20004000
+#define REGION_4K3_BASE_ADDR    0x20005000
+#define REGION_8K2_BASE_ADDR    0x20006000
+
+#define TOTAL_REGIONS   40          // Total number of subregions available across all memory regions
+
+
+typedef struct
+{
+    void *address;                                              // Base of the allocation
+    uint8_t subRegions;                                         // Number of subregions allocated here
+} legacyVirtualdata;
+
+//-----------------------------------------------------------------------------
+// Allocation Management
+//-----------------------------------------------------------------------------
+// Structures and arrays to track allocated memory blocks.
+
+static uint8_t legacyHeapTop = 0;
+static uint8_t legacyAllotment[TOTAL_REGIONS] = {0, };      // A ledger to keep track allocated subregions, initialised to 0
+static legacyVirtualdata legacyData[TOTAL_REGIONS] = {{0, 0}, };
+
+#define BLOCK_4K1_START 0
+#define BLOCK_4K1_END   7
+#define BLOCK_8K1_START 8
+#define BLOCK_8K1_END   15
+#define BLOCK_4K2_START 16
+#define BLOCK_4K2_END   23
+#define BLOCK_4K3_START 24
+#define BLOCK_4K3_END   31
+#define BLOCK_8K2_START 32
+#define BLOCK_8K2_END   39
+
+
+
+static void *legacyAllocation(uint8_t subRegions, uint8_t startRange, uint8_t endRange, uint32_t baseAddr, int16_t offset, uint16_t blockSize)
+{
+    uint8_t contiguousSpaces = 0, currentIndex;
+    for (currentIndex = startRange; currentIndex <= endRange; currentIndex++)
+    {
+        if (!(legacyAllotment[currentIndex]))
+        {
+            contiguousSpaces++;
+            if (contiguousSpaces >= subRegions)
+            {
+                int8_t i;
+                for ( i = 0; i < subRegions; i++)
+                {
+                    legacyAllotment[currentIndex - i] = 1;
+                }
+                legacyData[legacyHeapTop].subRegions = subRegions;
+                legacyData[legacyHeapTop].address = (void *)(uintptr_t)(baseAddr + ((currentIndex - subRegions  + offset) * blockSize));
+                return (void *)legacyData[legacyHeapTop++].address;
+            }
+
+        }
+        else
+        {
+            contiguousSpaces = 0;
+        }
+
+    }
+    return (void *)0;
+
+}
+    // Allocate memory based on requested size, rounding up to nearest block size.
+    // Attempts allocation in different regions based on block availability.
+    // Returns a pointer to allocated memory or NULL if allocation fails.
+static void * legacyMallocFromHeap(uint32_t size_in_bytes)
+{
+    void *ptr;
+
+
+    // Standardize the size based on the requested size
+    if (size_in_bytes <= 512) {
+        size_in_bytes = 512;  // Round up to 512 bytes
+    } else if (size_in_bytes <= 1024) {
+        size_in_bytes = 1024;  // Round up to 1024 bytes
+    } else if (size_in_bytes <= 1536) {
+        size_in_bytes = 1536;  // Set size to 1536 bytes
+    } else
+    {
+        // If size is greater than 1536 bytes, round up to the next multiple of 1024
+        size_in_bytes = ((size_in_bytes + 1023) / 1024) * 1024;
+    }
+
+
+
+    if (size_in_bytes == BLOCK_SIZE_512)
+    {
+        // Allocate a 512-byte block if available
+        if ((size_in_bytes / BLOCK_SIZE_512) > 0)
+        {
+            ptr = legacyAllocation(((size_in_bytes / BLOCK_SIZE_512)), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation(((size_in_bytes / BLOCK_SIZE_512)), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation(((size_in_bytes / BLOCK_SIZE_512)), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+           
+        }
+        else
+        {
+            // No 512-byte block available, return NULL or handle error
+        }
+    }
+    else if (size_in_bytes == BLOCK_SIZE_1024)
+    {
+        // Allocate a 1024-byte block if available
+        if ((size_in_bytes / BLOCK_SIZE_512) >= 2) // Check if there are at least 2 consecutive 512B blocks
+        {
+            ptr = legacyAllocation((2), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation((2), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation((2), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+            // Code to allocate two consecutive 512-byte blocks
+        }
+        else if ((size_in_bytes / BLOCK_SIZE_1024) > 0)
+        {
+            ptr = legacyAllocation(((size_in_bytes / BLOCK_SIZE_1024)), (BLOCK_8K1_START + 1), (BLOCK_8K1_END - 1), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation(((size_in_bytes / BLOCK_SIZE_1024)), (BLOCK_8K2_START + 1), (BLOCK_8K2_END), REGION_8K2_BASE_ADDR, -31, BLOCK_SIZE_1024);
+            if (ptr != 0) return (void *)ptr;
+           
+        }
+
+        else
+        {
+            // No 1024-byte or two consecutive 512-byte blocks available, return NULL or handle error
+        }
+    }
+    else if (size_in_bytes == BLOCK_SIZE_1536)
+    {
+        // Allocate a 1536-byte block if available
+        if(size_in_bytes == BLOCK_SIZE_1536)
+        {
+            ptr = legacyAllocation((2), (BLOCK_4K1_END), (BLOCK_8K1_START), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation((2), (BLOCK_8K1_END), (BLOCK_4K2_START), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation((2), (BLOCK_4K3_END), (BLOCK_8K2_START), REGION_4K3_BASE_ADDR, -23, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+            
+        }
+        else if ((size_in_bytes / BLOCK_SIZE_1024) > 0 && (size_in_bytes / BLOCK_SIZE_512) > 0) // Check if there is one 1024B and one 512B block
+        {
+            ptr = legacyAllocation((2), (BLOCK_8K1_START + 1), (BLOCK_8K1_END - 1), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation((2), (BLOCK_8K2_START + 1), (BLOCK_8K2_END), REGION_8K2_BASE_ADDR, -31, BLOCK_SIZE_1024);
+            if (ptr != 0) return (void *)ptr;
+           
+        }
+        else if ((size_in_bytes / BLOCK_SIZE_512) >= 3) // Check if there are at least 3 consecutive 512B blocks
+        {
+            ptr = legacyAllocation((3), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation((3), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+
+            ptr = legacyAllocation((3), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
+            if (ptr != 0) return (void *)ptr;
+         
+        }
+
+    }
+    else if (size_in_bytes >= 1536)
+    {
+       // Allocate multiple 1024-byte blocks for sizes 4096 bytes or larger
+       uint32_t required_blocks = size_in_bytes / BLOCK_SIZE_1024;
+
+       ptr = legacyAllocation(required_blocks, BLOCK_8K1_START + 1, BLOCK_8K1_END - 1, REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
+       if (ptr != 0) return ptr;
+
+       ptr = legacyAllocation(required_blocks, BLOCK_8K2_START + 1, BLOCK_8K2_END, REGION_8K2_BASE_ADDR, -31, BLOCK_SIZE_1024);
+       if (ptr != 0) return ptr;
+
+       required_blocks = size_in_bytes / BLOCK_SIZE_512;
+
+       ptr = legacyAllocation((required_blocks), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
+       if (ptr != 0) return (void *)ptr;
+
+       ptr = legacyAllocation((required_blocks), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
+       if (ptr != 0) return (void *)ptr;
+
+       ptr = legacyAllocation((required_blocks), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
+       if (ptr != 0) return (void *)ptr;
+
+
+    }
+
+
+
+    return 0;
+}
+
+// Deallocates previously allocated memory and updates the allocation ledger.
+static void legacyFreeToHeap(void *pMemory)
+{
+    uint8_t i,index;
+       // Identify the allocation entry based on the address (ptr)
+       for ( i = 0; i < legacyHeapTop; i++)
+       {
+           if (legacyData[i].address == pMemory)  // Check if the address matches
+           {
+               uint8_t startIndex = 0;
+               uint8_t endIndex = 0;
+               uint32_t address = (uint32_t)(uintptr_t)pMemory;
+
+               // Calculate the start index based on the region and address
+               if (address >= REGION_4K1_BASE_ADDR && address < REGION_8K1_BASE_ADDR)
+               {
+                   // Region 4K1: Calculate the start index based on 512-byte blocks
+                   startIndex = (address - REGION_4K1_BASE_ADDR) / BLOCK_SIZE_512;
+               }
+               else if (address >= REGION_8K1_BASE_ADDR && address < REGION_4K2_BASE_ADDR)
+               {
+                   // Region 8K1: Calculate the start index based on 1024-byte blocks
+                   startIndex = 8 + (address - REGION_8K1_BASE_ADDR) / BLOCK_SIZE_1024;
+               }
+               else if (address >= REGION_4K2_BASE_ADDR && address < REGION_4K3_BASE_ADDR)
+               {
+                   // Region 4K2: Calculate the start index based on 512-byte blocks
+                   startIndex = 16 + (address - REGION_4K2_BASE_ADDR) / BLOCK_SIZE_512;
+               }
+               else if (address >= REGION_4K3_BASE_ADDR && address < REGION_8K2_BASE_ADDR)
+               {
+                   // Region 4K3: Calculate the start index based on 512-byte blocks
+                   startIndex = 24 + (address - REGION_4K3_BASE_ADDR) / BLOCK_SIZE_512;
+               }
+               else if (address >= REGION_8K2_BASE_ADDR)
+               {
+                   // Region 8K2: Calculate the start index based on 1024-byte blocks
+                   startIndex = 32 + (address - REGION_8K2_BASE_ADDR) / BLOCK_SIZE_1024;
+               }
+
+
+               // Calculate the end index using the number of subregions
+               endIndex = startIndex + legacyData[i].subRegions - 1;
+
+               // Free the allocated regions by marking them as 0 in legacyAllotment
+               for ( index = startIndex; index <= endIndex; index++)
+               {
+                   legacyAllotment[index] = 0;
+               }
+
+               // Remove the entry from legacyData
+               legacyData[i].address = 0;  // Clear the address
+               legacyData[i].subRegions = 0;  // Clear the subregions count
+
+               //Adjust legacyHeapTop if necessary
+               if (i == legacyHeapTop - 1)  // If this was the last entry
+               {
+                   legacyHeapTop--;
+               }
+
+               return;  // Exit after successfully freeing
+           }
+       }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+
+// The previous allocator writes past its ledger once 40 entries are in use
+static void *legacyAllocate(uint32_t size)
+{
+    return (legacyHeapTop < TOTAL_REGIONS) ? legacyMallocFromHeap(size) : 0;
+}
+
+// The previous allocator can leak subregions, so start each run from an empty heap
+static void legacyReset(void)
+{
+    uint8_t i;
+    legacyHeapTop = 0;
+    for (i = 0; i < TOTAL_REGIONS; i++)
+    {
+        legacyAllotment[i] = 0;
+        legacyData[i].address = 0;
+        legacyData[i].subRegions = 0;
+    }
+}
+
+typedef struct _allocator
+{
+    const char *name;
+    void *(*allocate)(uint32_t size);
+    void (*release)(void *p);
+    void (*reset)(void);            // empties the heap between timed rounds (0 if freeing does)
+} allocator;
+
+static const allocator allocators[] =
+{
+    {"previous", legacyAllocate,       legacyFreeToHeap,   legacyReset},
+#if defined(HEAP_BUDDY)
+    {"buddy",    mallocFromHeap,       freeToHeap,         0},
+#else
+    {"bitmap",   mallocFromHeap,       freeToHeap,         0},
+#endif
+};
+#define ALLOCATORS (sizeof(allocators) / sizeof(allocators[0]))
+
+// Stack and buffer sizes seen in rtos.c and tasks.c
+static const uint32_t sizes[] = {512, 512, 1024, 1024, 1536, 2048, 4096, 300, 700, 1200};
+#define SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+typedef struct _churnStats
+{
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t fragmented;            // failures with enough free bytes for the request
+    uint64_t liveAtFailure;         // sum of bytes held when a request failed
+} churnStats;
+
+static void *live[BENCH_LIVE];
+static uint32_t liveSize[BENCH_LIVE];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Random allocate/free sequence; the allocation state is left empty afterwards
+static void churn(const allocator *a, churnStats *stats)
+{
+    uint32_t step, size, held = 0;
+    uint8_t i;
+
+    srand(3);
+    *stats = (churnStats){0};
+    for (i = 0; i < BENCH_LIVE; i++)
+        live[i] = 0;
+    for (step = 0; step < BENCH_STEPS; step++)
+    {
+        i = rand() % BENCH_LIVE;
+        if (live[i] != 0)
+        {
+            a->release(live[i]);
+            held -= liveSize[i];
+            live[i] = 0;
+        }
+        else
+        {
+            size = sizes[rand() % SIZES];
+            stats->requests++;
+            live[i] = a->allocate(size);
+            if (live[i] != 0)
+            {
+                liveSize[i] = size;
+                held += size;
+            }
+            else
+            {
+                stats->failures++;
+                stats->liveAtFailure += held;
+                if (HEAP_BYTES - held >= size)
+                    stats->fragmented++;
+            }
+        }
+    }
+    for (i = 0; i < BENCH_LIVE; i++)
+    {
+        if (live[i] != 0)
+            a->release(live[i]);
+    }
+}
+
+// Time allocating a set of mixed sizes and freeing them again
+// The previous allocator loses ledger entries when blocks are not freed in reverse
+// order, so every round starts from an empty heap; the time of the resets alone is
+// subtracted. Returns ns per successful allocate/free pair; failed allocations are
+// counted in *failures
+static double timeAllocator(const allocator *a, uint32_t *failures)
+{
+    uint32_t round;
+    uint8_t i;
+    clock_t start, resets = 0;
+    *failures = 0;
+    if (a->reset != 0)
+    {
+        start = clock();
+        for (round = 0; round < BENCH_ROUNDS; round++)
+            a->reset();
+        resets = clock() - start;
+    }
+    start = clock();
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        if (a->reset != 0)
+            a->reset();
+        for (i = 0; i < 8; i++)
+            live[i] = a->allocate(sizes[(round + i) % SIZES]);
+        for (i = 0; i < 8; i++)
+        {
+            if (live[i] != 0)
+                a->release(live[i]);
+            else
+                (*failures)++;
+        }
+    }
+    return 1e9 * (double)(clock() - start - resets) / CLOCKS_PER_SEC / (BENCH_ROUNDS * 8 - *failures);
+}
+
+int main(void)
+{
+    churnStats stats;
+    uint32_t timedFailures;
+    double ns;
+    uint8_t a;
+
+    printf("Random allocate/free, at most %d allocations held\n", BENCH_LIVE);
+    printf("  %-10s %10s %9s %9s %11s\n", "Allocator", "Requests", "Failed", "Fragment", "Held%@fail");
+    for (a = 0; a < ALLOCATORS; a++)
+    {
+        legacyReset();
+        churn(&allocators[a], &stats);
+        printf("  %-10s %10lu %9lu %9lu %11.1f\n", allocators[a].name,
+               (unsigned long)stats.requests, (unsigned long)stats.failures, (unsigned long)stats.fragmented,
+               stats.failures ? 100.0 * stats.liveAtFailure / stats.failures / HEAP_BYTES : 0.0);
+    }
+    printf("  (most failures of the previous allocator are its ledger filling up, not fragmentation)\n");
+
+    printf("\nAllocate 8 mixed sizes then free them (time per successful pair)\n");
+    printf("  %-10s %14s %9s\n", "Allocator", "ns/alloc+free", "Failed");
+    for (a = 0; a < ALLOCATORS; a++)
+    {
+        legacyReset();
+        ns = timeAllocator(&allocators[a], &timedFailures);
+        printf("  %-10s %14.1f %9lu\n", allocators[a].name, ns, (unsigned long)timedFailures);
+    }
+    return 0;
+}
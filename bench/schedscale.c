@@ -0,0 +1,175 @@
+// Scheduler scaling benchmark
+// Times the policy operations in sched.h and the delayed-task tick against the
+// number of tasks, to show that neither grows with the task count
+
+// Runs on the host, not the target. From the project directory:
+//   gcc -std=c99 -O2 -DMAX_TASKS=255 -I. -o schedscale bench/schedscale.c sched.c sched_prio.c sched_rr.c sched_edf.c sched_stride.c
+//   ./schedscale
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sched.h"
+
+#define SCALE_OPS 2000000           // scheduling decisions timed per policy and task count
+#define SCALE_TICKS 200000          // ticks timed per tick implementation and task count
+#define SCALE_SLEEP_PER_TASK 50     // longest simulated sleep per task, so wakeups per tick stay constant
+
+static const uint8_t taskCounts[] = {8, 32, 128, 254};
+#define SCALE_COUNTS (sizeof(taskCounts) / sizeof(taskCounts[0]))
+
+static uint32_t wakeTick[MAX_TASKS];
+static uint32_t sleepTicks[MAX_TASKS];
+static volatile uint32_t sink;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static double nsPerOp(clock_t start, clock_t end, uint32_t ops)
+{
+    return 1e9 * (double)(end - start) / CLOCKS_PER_SEC / ops;
+}
+
+// Time one pickNext plus one block and one wake, with about half the tasks ready
+static double timePolicy(uint8_t policy, uint8_t n)
+{
+    uint32_t op;
+    uint8_t i, current = 0, next, task;
+    clock_t start;
+
+    srand(1);
+    schedInit();
+    for (i = 0; i < n; i++)
+    {
+        schedTasks[i].priority = rand() % SCHED_NUM_PRIORITIES;
+        schedTasks[i].preemptThreshold = schedTasks[i].priority;
+        schedTasks[i].relativeDeadline = 1 + rand() % 100;
+        schedTasks[i].absoluteDeadline = schedTasks[i].relativeDeadline;
+        schedTasks[i].stride = STRIDE_ONE / (1 + rand() % 300);
+        schedTasks[i].pass = 0;
+        schedTasks[i].yielded = false;
+        schedTasks[i].ready = (i % 2 == 0);
+    }
+    schedSetPolicy(policy);
+
+    start = clock();
+    for (op = 0; op < SCALE_OPS; op++)
+    {
+        next = schedActive->pickNext(current, false);
+        if (next != 0xFF)
+        {
+            current = next;
+            schedActive->onTick(current);
+            // The running job completes
+            schedTasks[current].ready = false;
+            schedActive->onBlock(current);
+        }
+        // Another task is released
+        task = rand() % n;
+        if (!schedTasks[task].ready)
+        {
+            schedTasks[task].absoluteDeadline = op + schedTasks[task].relativeDeadline;
+            schedTasks[task].ready = true;
+            schedActive->onReady(task);
+        }
+    }
+    return nsPerOp(start, clock(), SCALE_OPS);
+}
+
+// Returns true if delayed task a wakes before delayed task b, as kernel.c
+static bool sleepBefore(uint8_t a, uint8_t b)
+{
+    return (int32_t)(wakeTick[a] - wakeTick[b]) < 0;
+}
+
+// Time the delayed-task tick with every task sleeping: a countdown per task
+// scanned each tick (the old systickIsr) against the wake tick heap
+// Sleeps grow with n so both see the same number of wakeups per tick
+static void timeTick(uint8_t n, double *scanNs, double *heapNs)
+{
+    static schedHeap sleepHeap = {{0}, {0}, 0, sleepBefore};
+    uint32_t maxSleep = n * SCALE_SLEEP_PER_TASK;
+    uint32_t tick;
+    uint8_t i, task;
+    clock_t start;
+
+    srand(2);
+    for (i = 0; i < n; i++)
+    {
+        sleepTicks[i] = 1 + rand() % maxSleep;
+    }
+    start = clock();
+    for (tick = 0; tick < SCALE_TICKS; tick++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (--sleepTicks[i] == 0)
+            {
+                sleepTicks[i] = 1 + rand() % maxSleep;
+                sink++;
+            }
+        }
+    }
+    *scanNs = nsPerOp(start, clock(), SCALE_TICKS);
+
+    srand(2);
+    schedHeapInit(&sleepHeap);
+    for (i = 0; i < n; i++)
+    {
+        wakeTick[i] = 1 + rand() % maxSleep;
+        schedHeapUpdate(&sleepHeap, i);
+    }
+    start = clock();
+    for (tick = 1; tick <= SCALE_TICKS; tick++)
+    {
+        while (sleepHeap.size > 0 && (int32_t)(tick - wakeTick[sleepHeap.task[0]]) >= 0)
+        {
+            task = sleepHeap.task[0];
+            wakeTick[task] = tick + 1 + rand() % maxSleep;
+            schedHeapUpdate(&sleepHeap, task);
+            sink++;
+        }
+    }
+    *heapNs = nsPerOp(start, clock(), SCALE_TICKS);
+}
+
+int main(void)
+{
+    uint8_t policy, c;
+    double scanNs, heapNs;
+
+    printf("Scheduling decision (pick + block + wake), ns\n");
+    printf("  %-8s", "Tasks");
+    for (c = 0; c < SCALE_COUNTS; c++)
+        printf(" %8u", taskCounts[c]);
+    printf("\n");
+    for (policy = 0; policy < SCHED_POLICY_COUNT; policy++)
+    {
+        printf("  %-8s", schedPolicies[policy]->name);
+        for (c = 0; c < SCALE_COUNTS; c++)
+            printf(" %8.1f", timePolicy(policy, taskCounts[c]));
+        printf("\n");
+    }
+
+    printf("\nDelayed-task tick, ns\n");
+    printf("  %-8s %8s %8s\n", "Tasks", "scan", "heap");
+    for (c = 0; c < SCALE_COUNTS; c++)
+    {
+        timeTick(taskCounts[c], &scanNs, &heapNs);
+        printf("  %-8u %8.1f %8.1f\n", taskCounts[c], scanNs, heapNs);
+    }
+
+    printf("\nScheduler RAM per task slot: %u bytes (schedTask) + %u bytes (per heap)\n",
+           (unsigned)sizeof(schedTask), (unsigned)(2 * sizeof(uint8_t)));
+    printf("Priority policy tables: %u bytes for %u priorities (%u shared with stride)\n",
+           (unsigned)(SCHED_NUM_PRIORITIES + SCHED_NUM_PRIORITIES / 8 + sizeof(uint32_t)), SCHED_NUM_PRIORITIES,
+           (unsigned)sizeof(schedPriorityTable));
+    return 0;
+}
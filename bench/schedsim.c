@@ -0,0 +1,170 @@
+// Scheduler policy simulation benchmark
+// Replays one synthetic workload under every scheduling policy in sched.h and
+// reports context switches, response times, deadline misses and CPU shares
+
+// Runs on the host, not the target. From the project directory:
+//   gcc -std=c99 -O2 -I. -o schedsim bench/schedsim.c sched.c sched_prio.c sched_rr.c sched_edf.c sched_stride.c
+//   ./schedsim
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sched.h"
+
+#define SIM_TICKS 100000            // 100 s of 1 ms ticks, a multiple of every period
+#define SIM_QUANTUM 1               // time slice in ticks, as DEFAULT_QUANTUM
+
+// Synthetic workload: periodic jobs (period > 0) and always-ready background
+// tasks (period = 0); priorities as assigned by createPeriodicThread()
+typedef struct _simTaskSpec
+{
+    const char *name;
+    uint8_t priority;
+    uint32_t period;                // ticks between releases (0 = always ready)
+    uint32_t wcet;                  // ticks of work per release
+    uint32_t deadline;              // relative deadline in ticks
+    uint32_t tickets;               // stride scheduling share
+} simTaskSpec;
+
+static const simTaskSpec workload[] =
+{
+    {"Idle",      15,  0,  0,  0, 100},
+    {"Control",    5,  5,  1,  5, 100},
+    {"Sensor",     6,  8,  2,  8, 100},
+    {"Logger",     7, 20,  4, 20, 100},
+    {"Filter",     8, 40, 10, 40, 100},
+    {"Shell",     12,  0,  0,  0, 300},
+    {"Telemetry", 12,  0,  0,  0, 100},
+};
+#define SIM_TASKS (sizeof(workload) / sizeof(workload[0]))
+
+typedef struct _simTaskStats
+{
+    uint32_t remaining;             // ticks of work left in the current job
+    uint32_t releaseTick;
+    uint32_t jobs;
+    uint32_t completed;
+    uint32_t misses;
+    uint64_t responseSum;
+    uint32_t responseMax;
+    uint32_t runTicks;
+} simTaskStats;
+
+static simTaskStats stats[SIM_TASKS];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void makeReady(uint8_t task)
+{
+    if (!schedTasks[task].ready)
+    {
+        schedTasks[task].ready = true;
+        schedActive->onReady(task);
+    }
+}
+
+static void makeBlocked(uint8_t task)
+{
+    if (schedTasks[task].ready)
+    {
+        schedTasks[task].ready = false;
+        schedActive->onBlock(task);
+    }
+}
+
+// Simulate the workload under one policy, returns the number of context switches
+static uint32_t simulate(uint8_t policy)
+{
+    uint32_t tick, switches = 0, slice = 0;
+    uint8_t i, current = 0, next;
+
+    schedInit();
+    for (i = 0; i < SIM_TASKS; i++)
+    {
+        schedTasks[i].priority = workload[i].priority;
+        schedTasks[i].preemptThreshold = workload[i].priority;
+        schedTasks[i].relativeDeadline = workload[i].deadline;
+        schedTasks[i].stride = STRIDE_ONE / workload[i].tickets;
+        schedTasks[i].pass = 0;
+        schedTasks[i].yielded = false;
+        stats[i] = (simTaskStats){0};
+        if (workload[i].period == 0)
+            schedTasks[i].ready = true;
+    }
+    schedSetPolicy(policy);
+
+    for (tick = 0; tick < SIM_TICKS; tick++)
+    {
+        // Release periodic jobs; an unfinished job is counted as missed and replaced
+        for (i = 0; i < SIM_TASKS; i++)
+        {
+            if (workload[i].period != 0 && tick % workload[i].period == 0)
+            {
+                if (stats[i].remaining > 0)
+                    stats[i].misses++;
+                stats[i].remaining = workload[i].wcet;
+                stats[i].releaseTick = tick;
+                stats[i].jobs++;
+                schedTasks[i].absoluteDeadline = tick + workload[i].deadline;
+                schedUpdate(i);
+                makeReady(i);
+            }
+        }
+
+        // Dispatch, as rtosScheduler() does
+        next = schedActive->pickNext(current, schedTasks[current].ready && slice > 0);
+        if (next != current || slice == 0)
+            slice = SIM_QUANTUM;
+        if (next != current)
+            switches++;
+        current = next;
+        schedTasks[current].yielded = false;
+
+        // Run the selected task for one tick
+        schedActive->onTick(current);
+        slice--;
+        stats[current].runTicks++;
+        if (workload[current].period != 0 && --stats[current].remaining == 0)
+        {
+            uint32_t response = tick + 1 - stats[current].releaseTick;
+            stats[current].completed++;
+            stats[current].responseSum += response;
+            if (response > stats[current].responseMax)
+                stats[current].responseMax = response;
+            if (response > workload[current].deadline)
+                stats[current].misses++;
+            makeBlocked(current);
+        }
+    }
+    return switches;
+}
+
+int main(void)
+{
+    uint8_t policy, i;
+    uint32_t switches;
+
+    for (policy = 0; policy < SCHED_POLICY_COUNT; policy++)
+    {
+        switches = simulate(policy);
+        printf("Policy %-6s  context switches %lu\n", schedPolicies[policy]->name, (unsigned long)switches);
+        printf("  %-10s %6s %8s %8s %7s %7s\n", "Task", "Jobs", "AvgResp", "MaxResp", "Missed", "CPU%");
+        for (i = 0; i < SIM_TASKS; i++)
+        {
+            printf("  %-10s %6lu %8.2f %8lu %7lu %7.2f\n", workload[i].name,
+                   (unsigned long)stats[i].jobs,
+                   stats[i].completed ? (double)stats[i].responseSum / stats[i].completed : 0.0,
+                   (unsigned long)stats[i].responseMax,
+                   (unsigned long)stats[i].misses,
+                   100.0 * stats[i].runTicks / SIM_TICKS);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,403 @@
+// Heap allocator
+// Hands out runs of MPU subregions from the task heap (0x20001000-0x20007FFF)
+// Best-fit runs by default, or buddy blocks when built with HEAP_BUDDY defined
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mm.h"
+
+#define TOTAL_REGIONS   (NUM_SRAM_REGIONS * SUBREGIONS_PER_REGION)   // Total number of subregions
+
+// Count leading zeros, a single CLZ instruction on the M4
+#if defined(__TI_COMPILER_VERSION__)
+#define HEAP_CLZ(x) _norm(x)
+#else
+#define HEAP_CLZ(x) __builtin_clz(x)
+#endif
+
+// Count trailing zeros of a non-zero value
+#define HEAP_CTZ(x) (31 - HEAP_CLZ((x) & -(x)))
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+// The regions are contiguous and in address order, so subregion n of the heap is
+// subregion n % 8 of region n / 8
+const MemoryRegion regions[NUM_SRAM_REGIONS] =
+{
+    { 0x20001000, 512  },  // Region 0: 4 KB with 512B subregions
+    { 0x20002000, 1024 },  // Region 1: 8 KB with 1024B subregions
+    { 0x20004000, 512  },  // Region 2: 4 KB with 512B subregions
+    { 0x20005000, 512  },  // Region 3: 4 KB with 512B subregions
+    { 0x20006000, 1024 }   // Region 4: 8 KB with 1024B subregions
+};
+
+// Bit n set while subregion n of the region is free
+uint8_t freeSubregions[NUM_SRAM_REGIONS] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Number of subregions in the allocation starting at each subregion (0 = no allocation starts there)
+uint8_t allocationLength[TOTAL_REGIONS] = {0, };
+
+// Task that owns the allocation starting at each subregion
+uint8_t allocationOwner[TOTAL_REGIONS];
+
+// Usage counters, updated as blocks are allocated and freed
+heapStats heapStatistics =
+{
+    0, 0, {0, }, 0,
+    {8 * 512, 8 * 1024, 8 * 512, 8 * 512, 8 * 1024},
+    0
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Returns the heap subregion number that starts at address, or 0xFF if no subregion does
+static uint8_t subregionAt(uint32_t address)
+{
+    uint8_t r;
+    uint32_t offset;
+    for (r = NUM_SRAM_REGIONS - 1; r > 0 && address < regions[r].baseAddress; r--);
+    offset = address - regions[r].baseAddress;
+    if (address < regions[0].baseAddress || offset % regions[r].subregionSize != 0
+        || offset / regions[r].subregionSize >= SUBREGIONS_PER_REGION)
+        return 0xFF;
+    return r * SUBREGIONS_PER_REGION + offset / regions[r].subregionSize;
+}
+
+// Returns the address of heap subregion n
+static void *subregionAddress(uint8_t n)
+{
+    uint8_t r = n / SUBREGIONS_PER_REGION;
+    return (void *)(uintptr_t)(regions[r].baseAddress + (n % SUBREGIONS_PER_REGION) * regions[r].subregionSize);
+}
+
+// Returns the length of the longest run of set bits in a subregion mask
+static uint8_t longestRun(uint8_t free)
+{
+    uint8_t length = 0;
+    while (free != 0)
+    {
+        free &= free >> 1;
+        length++;
+    }
+    return length;
+}
+
+// Mark count subregions of the heap starting at subregion first as used (used = true) or free
+// and update the bytes in use, the largest free run of the regions touched and the
+// fragmentation index
+static void markSubregions(uint8_t first, uint8_t count, bool used)
+{
+    uint32_t largest = 0, free;
+    uint8_t n, r;
+    for (n = first; n < first + count; n++)
+    {
+        r = n / SUBREGIONS_PER_REGION;
+        if (used)
+        {
+            freeSubregions[r] &= ~(1 << (n % SUBREGIONS_PER_REGION));
+            heapStatistics.bytesInUse += regions[r].subregionSize;
+        }
+        else
+        {
+            freeSubregions[r] |= 1 << (n % SUBREGIONS_PER_REGION);
+            heapStatistics.bytesInUse -= regions[r].subregionSize;
+        }
+    }
+    for (r = first / SUBREGIONS_PER_REGION; r <= (first + count - 1) / SUBREGIONS_PER_REGION; r++)
+    {
+        heapStatistics.largestFree[r] = longestRun(freeSubregions[r]) * regions[r].subregionSize;
+    }
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
+    {
+        if (heapStatistics.largestFree[r] > largest)
+            largest = heapStatistics.largestFree[r];
+    }
+    free = HEAP_BYTES - heapStatistics.bytesInUse;
+    heapStatistics.fragmentation = (free == 0) ? 0 : 100 - (100 * largest) / free;
+}
+
+// Count a refused request under its size class
+static void countFailure(uint32_t size_in_bytes)
+{
+    uint8_t c = 0;
+    while (c < HEAP_SIZE_CLASSES - 1 && (512u << c) < size_in_bytes)
+        c++;
+    heapStatistics.failures[c]++;
+}
+
+#if defined(HEAP_BUDDY)
+
+// Buddy allocator
+// Each MPU region is a buddy tree from one subregion (order 0) to the whole region
+// (order 3), so every block is a naturally aligned run of 1, 2, 4 or 8 subregions
+// inside one region and its SRD bits are a single aligned field
+
+#define BUDDY_ORDERS 4
+
+// Bit n of freeBlocks[r][k] set while block n of order k in region r is free and unsplit
+static uint8_t freeBlocks[NUM_SRAM_REGIONS][BUDDY_ORDERS] =
+{
+    {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}
+};
+
+// Allocate the smallest block that holds size_in_bytes, preferring the region that
+// wastes the fewest bytes and then the one that needs the fewest splits
+// Returns a pointer to allocated memory or NULL if allocation fails
+void * mallocFromHeap(uint32_t size_in_bytes)
+{
+    uint32_t bestWaste = 0xFFFFFFFF, waste;
+    uint8_t r, k, j, block, first;
+    uint8_t bestRegion = 0, bestOrder = 0, bestFrom = BUDDY_ORDERS;
+
+    if (size_in_bytes == 0)
+        return 0;
+
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
+    {
+        for (k = 0; k < BUDDY_ORDERS && (regions[r].subregionSize << k) < size_in_bytes; k++);
+        for (j = k; j < BUDDY_ORDERS && freeBlocks[r][j] == 0; j++);
+        if (j == BUDDY_ORDERS)
+            continue;
+        waste = (regions[r].subregionSize << k) - size_in_bytes;
+        if (waste < bestWaste || (waste == bestWaste && j < bestFrom))
+        {
+            bestWaste = waste;
+            bestRegion = r;
+            bestOrder = k;
+            bestFrom = j;
+        }
+    }
+
+    if (bestFrom == BUDDY_ORDERS)
+    {
+        countFailure(size_in_bytes);
+        return 0;
+    }
+
+    // Take the lowest free block and split it down, freeing the upper half each time
+    r = bestRegion;
+    j = bestFrom;
+    block = HEAP_CTZ(freeBlocks[r][j]);
+    freeBlocks[r][j] &= ~(1 << block);
+    while (j > bestOrder)
+    {
+        j--;
+        block *= 2;
+        freeBlocks[r][j] |= 1 << (block + 1);
+    }
+
+    first = r * SUBREGIONS_PER_REGION + (block << bestOrder);
+    markSubregions(first, 1 << bestOrder, true);
+    allocationLength[first] = 1 << bestOrder;
+    allocationOwner[first] = HEAP_OWNER_KERNEL;
+    heapStatistics.allocations++;
+    return subregionAddress(first);
+}
+
+// Deallocates previously allocated memory, merging the block with its free buddies
+// Pointers that do not start an allocation are ignored
+void freeToHeap(void *pMemory)
+{
+    uint8_t n = subregionAt((uint32_t)(uintptr_t)pMemory);
+    uint8_t r, k, block;
+    if (n == 0xFF || allocationLength[n] == 0)
+        return;
+
+    r = n / SUBREGIONS_PER_REGION;
+    k = HEAP_CTZ(allocationLength[n]);
+    block = (n % SUBREGIONS_PER_REGION) >> k;
+    markSubregions(n, allocationLength[n], false);
+    allocationLength[n] = 0;
+    heapStatistics.frees++;
+    while (k < BUDDY_ORDERS - 1 && (freeBlocks[r][k] & (1 << (block ^ 1))) != 0)
+    {
+        freeBlocks[r][k] &= ~(1 << (block ^ 1));
+        block >>= 1;
+        k++;
+    }
+    freeBlocks[r][k] |= 1 << block;
+}
+
+#else
+
+// Returns a mask of the subregions that start a run of count free subregions
+static uint8_t freeRuns(uint8_t free, uint8_t count)
+{
+    uint8_t i;
+    for (i = 1; i < count && free != 0; i++)
+    {
+        free &= free >> 1;
+    }
+    return free;
+}
+
+// Allocate the run of subregions that wastes the fewest bytes
+// Candidates are the lowest free run inside each region and the runs that join the
+// free top of a region to the free bottom of the next one (e.g. 512 + 1024 bytes)
+// Returns a pointer to allocated memory or NULL if allocation fails
+void * mallocFromHeap(uint32_t size_in_bytes)
+{
+    uint32_t bestWaste = 0xFFFFFFFF, waste, size, count;
+    uint8_t bestFirst = 0, bestCount = 0;
+    uint8_t r, top, bottom, runs;
+    uint32_t topSize, bottomSize;
+
+    if (size_in_bytes == 0)
+        return 0;
+    if (size_in_bytes > HEAP_BYTES)
+    {
+        countFailure(size_in_bytes);
+        return 0;
+    }
+
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
+    {
+        // Inside region r
+        count = (size_in_bytes + regions[r].subregionSize - 1) / regions[r].subregionSize;
+        if (count <= SUBREGIONS_PER_REGION)
+        {
+            runs = freeRuns(freeSubregions[r], count);
+            waste = count * regions[r].subregionSize - size_in_bytes;
+            if (runs != 0 && waste < bestWaste)
+            {
+                bestWaste = waste;
+                bestFirst = r * SUBREGIONS_PER_REGION + HEAP_CTZ(runs);
+                bestCount = count;
+            }
+        }
+
+        // Across the boundary between region r and region r + 1
+        if (r + 1 < NUM_SRAM_REGIONS)
+        {
+            // free subregions at the top of r and at the bottom of r + 1
+            top = (freeSubregions[r] == 0xFF) ? 8 : HEAP_CLZ((uint32_t)(uint8_t)~freeSubregions[r] << 24);
+            bottom = (freeSubregions[r + 1] == 0xFF) ? 8 : HEAP_CTZ((uint32_t)(uint8_t)~freeSubregions[r + 1]);
+            topSize = regions[r].subregionSize;
+            bottomSize = regions[r + 1].subregionSize;
+            for (count = 1; count <= top && count * topSize < size_in_bytes; count++)
+            {
+                size = (size_in_bytes - count * topSize + bottomSize - 1) / bottomSize;
+                waste = count * topSize + size * bottomSize - size_in_bytes;
+                if (size <= bottom && waste < bestWaste)
+                {
+                    bestWaste = waste;
+                    bestFirst = (r + 1) * SUBREGIONS_PER_REGION - count;
+                    bestCount = count + size;
+                }
+            }
+        }
+    }
+
+    if (bestCount == 0)
+    {
+        countFailure(size_in_bytes);
+        return 0;
+    }
+
+    markSubregions(bestFirst, bestCount, true);
+    allocationLength[bestFirst] = bestCount;
+    allocationOwner[bestFirst] = HEAP_OWNER_KERNEL;
+    heapStatistics.allocations++;
+    return subregionAddress(bestFirst);
+}
+
+// Deallocates previously allocated memory and updates the allocation ledger.
+// The ledger is indexed by the first subregion of the allocation, so no search is
+// needed; pointers that do not start an allocation are ignored
+void freeToHeap(void *pMemory)
+{
+    uint8_t n = subregionAt((uint32_t)(uintptr_t)pMemory);
+    if (n != 0xFF && allocationLength[n] != 0)
+    {
+        markSubregions(n, allocationLength[n], false);
+        allocationLength[n] = 0;
+        heapStatistics.frees++;
+    }
+}
+
+#endif
+
+// Give an allocation to a task so it is freed with freeHeapOwnedBy()
+void setHeapOwner(void *pMemory, uint8_t owner)
+{
+    uint8_t n = subregionAt((uint32_t)(uintptr_t)pMemory);
+    if (n != 0xFF && allocationLength[n] != 0)
+        allocationOwner[n] = owner;
+}
+
+// Returns the owner of an allocation, HEAP_OWNER_KERNEL if pMemory does not start one
+uint8_t getHeapOwner(void *pMemory)
+{
+    uint8_t n = subregionAt((uint32_t)(uintptr_t)pMemory);
+    if (n != 0xFF && allocationLength[n] != 0)
+        return allocationOwner[n];
+    return HEAP_OWNER_KERNEL;
+}
+
+// Free every allocation owned by a task (one pass over the allocation starts)
+void freeHeapOwnedBy(uint8_t owner)
+{
+    uint8_t n;
+    for (n = 0; n < TOTAL_REGIONS; n++)
+    {
+        if (allocationLength[n] != 0 && allocationOwner[n] == owner)
+            freeToHeap(subregionAddress(n));
+    }
+}
+
+// Returns the bytes in the allocation starting at heap subregion n
+static uint32_t allocationBytes(uint8_t n)
+{
+    uint32_t bytes = 0;
+    uint8_t m;
+    for (m = n; m < n + allocationLength[n]; m++)
+        bytes += regions[m / SUBREGIONS_PER_REGION].subregionSize;
+    return bytes;
+}
+
+// Returns the bytes of heap owned by a task and the number of its allocations through blocks
+uint32_t heapOwnedBytes(uint8_t owner, uint8_t *blocks)
+{
+    uint32_t bytes = 0;
+    uint8_t n;
+    *blocks = 0;
+    for (n = 0; n < TOTAL_REGIONS; n++)
+    {
+        if (allocationLength[n] != 0 && allocationOwner[n] == owner)
+        {
+            (*blocks)++;
+            bytes += allocationBytes(n);
+        }
+    }
+    return bytes;
+}
+
+// Returns the size of an allocation in whole subregions, 0 if pMemory does not start one
+uint32_t heapAllocationBytes(void *pMemory)
+{
+    uint8_t n = subregionAt((uint32_t)(uintptr_t)pMemory);
+    if (n != 0xFF && allocationLength[n] != 0)
+        return allocationBytes(n);
+    return 0;
+}
+
+// Returns the bytes of heap not allocated
+uint32_t heapFreeBytes(void)
+{
+    return HEAP_BYTES - heapStatistics.bytesInUse;
+}
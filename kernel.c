@@ -12,6 +12,7 @@
 //-----------------------------------------------------------------------------
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "tm4c123gh6pm.h"
 #include "mm.h"
 #include "kernel.h"
@@ -19,6 +20,8 @@
 #include "uart0.h"
 #include "shell.h"
 #include "string.h"
+#include "sched.h"
+#include "pool.h"
 //-----------------------------------------------------------------------------
 // RTOS Defines and Kernel Variables
 //-----------------------------------------------------------------------------
@@ -42,6 +45,71 @@ typedef struct _semaphore
 } semaphore;
 semaphore semaphores[MAX_SEMAPHORES];
 
+// stream buffer
+typedef struct _streamBuffer
+{
+    uint8_t data[STREAM_BUFFER_SIZE];
+    uint16_t head;                  // next position written by the producer
+    uint16_t tail;                  // next position read by the consumer
+    uint16_t count;                 // bytes currently held in the buffer
+    uint16_t triggerLevel;          // bytes required before a blocked reader is woken
+    uint32_t timeout;               // ticks a reader waits before taking a partial chunk (0 = forever)
+    uint8_t reader;                 // task blocked on this stream (0xFF if none)
+    uint8_t *readBuffer;            // destination of the pending receive
+    uint16_t readLength;            // capacity of the pending receive
+    uint16_t *readCount;            // where the pending receive reports the bytes copied
+    uint32_t bytesReceived;         // total bytes handed to readers
+    uint32_t wakeups;               // number of times a reader was handed data
+    uint32_t emptyTimeouts;         // reader timeouts that found no data
+    uint32_t overruns;              // bytes dropped because the buffer was full
+} streamBuffer;
+streamBuffer streams[MAX_STREAM_BUFFERS];
+
+// software timer
+typedef struct _swTimer
+{
+    _fn callback;                   // function run by the timer service task
+    uint32_t period;                // ticks between expiries
+    uint32_t expiry;                // systemTickCount at which the timer fires next
+    bool autoReload;                // re-arm after firing (true) or one-shot (false)
+    bool queued;                    // expired and waiting for the timer service task
+    uint8_t heapIndex;              // position in timerHeap (0xFF if not armed)
+} swTimer;
+swTimer timers[MAX_TIMERS];
+
+uint8_t timerHeap[MAX_TIMERS];                  // armed timers, min-heap ordered by expiry
+uint8_t timerHeapSize = 0;
+uint8_t timerQueue[MAX_TIMER_QUEUE_SIZE];       // expired timers waiting for their callback to run
+uint8_t timerQueueHead = 0;
+uint8_t timerQueueSize = 0;
+uint8_t timerServiceTask = 0xFF;                // timer service task when blocked (0xFF if running)
+_fn *timerServiceCallback;                      // where the blocked service task receives its callback
+
+// shared memory segment
+typedef struct _sharedSegment
+{
+    char name[16];                  // looked up by openSharedSegment()
+    void *base;                     // heap block owned by the kernel (0 = segment not created)
+    uint32_t size;
+    uint64_t mask;                  // heap subregions of the segment
+} sharedSegment;
+sharedSegment segments[MAX_SHARED_SEGMENTS];
+
+// cyclic executive schedule table
+typedef struct _cyclicEntry
+{
+    uint32_t offset;                // ticks from the start of the major frame
+    uint8_t task;                   // task released at that offset
+} cyclicEntry;
+cyclicEntry cyclicTable[MAX_CYCLIC_ENTRIES];    // sorted by offset
+uint8_t cyclicEntries = 0;
+uint32_t minorFrameLength = 0;                  // ticks per minor frame (0 = cyclic executive off)
+uint8_t minorFramesPerMajor = 0;
+uint32_t cyclicTick = 0;                        // ticks into the current major frame
+uint8_t cyclicNext = 0;                         // next table entry to release
+uint32_t majorFrameCount = 0;
+uint32_t frameOverruns[MAX_MINOR_FRAMES];       // frames that ended with a released task still running
+
 // task states
 #define STATE_INVALID           0 // no task
 #define STATE_STOPPED           1 // stopped, all memory freed
@@ -49,6 +117,21 @@ semaphore semaphores[MAX_SEMAPHORES];
 #define STATE_DELAYED           3 // has run, but now awaiting timer
 #define STATE_BLOCKED_MUTEX     4 // has run, but now blocked by semaphore
 #define STATE_BLOCKED_SEMAPHORE 5 // has run, but now blocked by semaphore
+#define STATE_BLOCKED_STREAM    6 // has run, but now waiting for stream data
+#define STATE_BLOCKED_TIMER     7 // has run, but now waiting for a timer to expire
+#define STATE_THROTTLED         8 // has run, but exhausted its budget until replenishment
+#define STATE_BLOCKED_RELEASE   9 // has run, but now waiting for its cyclic release
+#define STATE_SUSPENDED        10 // low criticality, held while the kernel is in high criticality mode
+
+// task flags
+#define TASK_CYCLIC             0x01 // released by the cyclic executive schedule table
+#define TASK_LO_CRITICALITY     0x02 // suspended while the kernel is in high criticality mode
+#define TASK_RELEASE_PENDING    0x04 // released from a delay but not yet dispatched
+#define TASK_RELEASE_HELD       0x08 // released while suspended, starts a new job on resume
+#define TASK_CYCLIC_JOB         0x10 // released by the schedule table, waitNextRelease() not yet called
+
+// no side table entry
+#define NO_SLOT 0xFF
 
 // task
 uint8_t taskCurrent = 0;          // index of last dispatched task
@@ -56,32 +139,101 @@ uint8_t taskCount = 0;            // total number of valid tasks
 
 
 uint32_t systemTickCount = 0;
+
+// kernel data page, read-only for tasks (see setupSramAccess)
+// aligned to its size so a single MPU region covers it, in its own section that
+// the linker places at the start of SRAM where the alignment costs no padding
+#if KERNEL_PAGE_SIZE == 0
+#error "MAX_TASKS is too large for the kernel page"
+#endif
+#pragma DATA_SECTION(kernelData, ".kernel")
+#pragma DATA_ALIGN(kernelData, KERNEL_PAGE_SIZE)
+volatile kernelPage kernelData;
+typedef char kernelPageFits[(sizeof(kernelPage) <= KERNEL_PAGE_BYTES) ? 1 : -1];
 uint32_t systemTickCount_S;
 uint32_t start_time, end_time;
 
+// SysTick and the wide timers run from the 40 MHz system clock
+#define CYCLES_PER_US 40
+
 // control
-volatile bool priorityScheduler = true;    // priority (true) or round-robin (false)
 volatile bool priorityInheritance = false; // priority inheritance for mutexes
 volatile bool preemption = true;          // preemption (true) or cooperative (false)
 
 // tcb
-#define NUM_PRIORITIES   16
+// Fields are ordered so the 64-bit masks need no padding (112 bytes per task)
 struct _tcb
 {
-    uint8_t state;                 // see STATE_ values above
     void *pid;                     // used to uniquely identify thread (add of task fn)
     void *spInit;                  // original top of stack
     void *sp;                      // current stack pointer
+    uint8_t state;                 // see STATE_ values above
     uint8_t priority;              // 0=highest
     uint8_t currentPriority;       // 0=highest (needed for pi)
-    uint32_t ticks;                // ticks until sleep complete
-    uint64_t srd;                  // MPU subregion disable bits
-    char name[16];                 // name of task used in ps command
+    uint32_t ticks;                // ticks until a stream receive times out (0 = forever)
+    uint32_t wakeTick;             // systemTickCount at which a delayed task is released
+    uint64_t srd;                  // heap subregions the task owns (stack and heap blocks)
+    uint64_t granted;              // kernel-owned heap granted at init time (pools), kept across restarts
+    uint32_t mpuImage[NUM_SRAM_REGIONS]; // heap region RASR values built from srd, stored by pendSvIsr()
     uint8_t mutex;                 // index of the mutex in use or blocking the thread
     uint8_t semaphore;             // index of the semaphore that is blocking the thread
+    uint8_t stream;                // index of the stream buffer that is blocking the thread
 uint32_t runtime;                 // Cumulative runtime of the task (useful for profiling and scheduling decisions)
+    uint32_t deadlineMisses;       // jobs completed after their absolute deadline
+    uint32_t period;               // release period in ticks (0 = not a periodic task)
+    uint32_t wcet;                 // worst-case execution time per release in ticks
+    uint32_t interval;             // shortest time between releases of a non-periodic task in ticks
+    uint32_t nextRelease;          // systemTickCount of the next release of a periodic task
+    uint32_t quantum;              // time slice in ticks before rotating to an equal task
+    uint32_t sliceRemaining;       // ticks left in the current time slice
+    struct _jitter *jitter;        // release jitter record from JITTER_POOL (0 = not measured yet)
+    uint16_t stackBytes;           // stack size, reallocated when a stopped thread restarts
+    uint8_t sharedRead;            // bit s set if shared segment s is mapped read-only
+    uint8_t sharedWrite;           // bit s set if shared segment s is mapped read-write
+    uint8_t flags;                 // see TASK_ values above
+    uint8_t budgetSlot;            // entry in budgets[] (NO_SLOT = unlimited)
 } tcb[MAX_TASKS];
 
+// CPU budgets, kept out of the tcb since few tasks have one
+struct _budget
+{
+    uint8_t task;                  // task charged against this budget
+    uint32_t budget;               // ticks of CPU time allowed per budget period
+    uint32_t period;               // ticks between budget replenishments
+    uint32_t remaining;            // ticks left in the current budget period
+    uint32_t replenish;            // systemTickCount of the next replenishment
+    uint32_t throttles;            // number of times the budget was exhausted
+    uint32_t hiBudget;             // budget per period in high criticality mode (0 = no mode switch)
+} budgets[MAX_BUDGETED_TASKS];
+uint8_t budgetCount = 0;
+
+// Release jitter statistics, a block of the kernel's JITTER_POOL taken by each
+// task when it is first released
+struct _jitter
+{
+    uint64_t releaseTime;          // timestamp at which the task was last released from a delay
+    uint32_t releases;             // number of releases measured
+    uint32_t jitterMin;            // shortest release-to-dispatch latency (us)
+    uint32_t jitterMax;            // longest release-to-dispatch latency (us)
+    uint64_t jitterSum;            // sum of release-to-dispatch latencies (us)
+};
+
+volatile bool rescheduleRequested = false;      // a task became ready since the last scheduling decision
+
+uint8_t criticalityMode = CRITICALITY_LO;       // see CRITICALITY_ values in kernel.h
+uint8_t modeTrigger = 0xFF;                     // task whose overrun entered high criticality mode
+uint16_t modeSwitches = 0;
+
+uint32_t switchCycles = 0;                      // cycles spent in the last pendSvSwitch()
+
+// Returns true if delayed task a wakes before delayed task b (tick counter wraps)
+bool sleepBefore(uint8_t a, uint8_t b)
+{
+    return (int32_t)(tcb[a].wakeTick - tcb[b].wakeTick) < 0;
+}
+
+schedHeap sleepHeap = {{0}, {0}, 0, sleepBefore};  // delayed tasks, min-heap ordered by wake tick
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
@@ -98,6 +250,41 @@ void initTimer(void)
     WTIMER0_TAV_R        = 0;                       // Reset the timer value
 }
 
+// Initialize the Wide Timer 1 as a free-running 64-bit up-counter
+// This is the monotonic system clock; it is never stopped or reset
+void initSystemTime(void)
+{
+    SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R1;    // Enable and provide clock to the timer
+    _delay_cycles(3);
+
+    WTIMER1_CTL_R       &= ~TIMER_CTL_TAEN;         // Disable timer before configuring
+    WTIMER1_CFG_R       = TIMER_CFG_32_BIT_TIMER;   // Concatenate A and B into a 64-bit timer
+    WTIMER1_TAMR_R      = TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR; // Periodic, up-counter
+    WTIMER1_TAILR_R     = 0xFFFFFFFF;               // Count the full 64-bit range
+    WTIMER1_TBILR_R     = 0xFFFFFFFF;
+    WTIMER1_CTL_R       |= TIMER_CTL_TAEN;          // Start counting
+}
+
+// Read the 64-bit monotonic clock in system clock cycles (25 ns)
+// Reads only a peripheral register, so unprivileged tasks can call it without an SVC
+// The high word is read again to catch a carry out of the low word between the reads
+uint64_t getTimestamp(void)
+{
+    uint32_t high, low;
+    do
+    {
+        high = WTIMER1_TBV_R;
+        low = WTIMER1_TAV_R;
+    } while (high != WTIMER1_TBV_R);
+    return ((uint64_t)high << 32) | low;
+}
+
+// Read the 64-bit monotonic clock in microseconds
+uint64_t getTimeUs(void)
+{
+    return getTimestamp() / CYCLES_PER_US;
+}
+
 // Initialize a mutex
 bool initMutex(uint8_t mutex)
 {
@@ -119,7 +306,491 @@ bool initSemaphore(uint8_t semaphore, uint8_t count)
     return ok;                                      // Return true if initialization succeeded, false otherwise
 }
 
+// Initialize a stream buffer
+// A blocked reader is woken once triggerLevel bytes are available or after timeout ticks
+bool initStreamBuffer(uint8_t stream, uint16_t triggerLevel, uint32_t timeout)
+{
+    bool ok = (stream < MAX_STREAM_BUFFERS) && (triggerLevel > 0) && (triggerLevel <= STREAM_BUFFER_SIZE);
+    if (ok)
+    {
+        streams[stream].head = 0;
+        streams[stream].tail = 0;
+        streams[stream].count = 0;
+        streams[stream].triggerLevel = triggerLevel;
+        streams[stream].timeout = timeout;
+        streams[stream].reader = 0xFF;              // No reader waiting
+        streams[stream].bytesReceived = 0;
+        streams[stream].wakeups = 0;
+        streams[stream].emptyTimeouts = 0;
+        streams[stream].overruns = 0;
+    }
+    return ok;
+}
 
+// Determine the resource a task is blocked on for ps
+void getBlockingResource(uint8_t task, uint8_t *type, uint8_t *id)
+{
+    if (tcb[task].state == STATE_BLOCKED_MUTEX)
+    {
+        *type = 1;
+        *id = tcb[task].mutex;
+    }
+    else if (tcb[task].state == STATE_BLOCKED_SEMAPHORE)
+    {
+        *type = 2;
+        *id = tcb[task].semaphore;
+    }
+    else if (tcb[task].state == STATE_BLOCKED_STREAM)
+    {
+        *type = 3;
+        *id = tcb[task].stream;
+    }
+    else if (tcb[task].state == STATE_BLOCKED_TIMER)
+    {
+        *type = 4;
+        *id = 0;
+    }
+    else
+    {
+        *type = 0;
+        *id = 0xFF;
+    }
+}
+
+// Copy the heap usage summary to the kernel data page (inside the page update)
+void publishHeapStats(void)
+{
+    uint16_t largest = 0, failures = 0;
+    uint8_t i;
+    for (i = 0; i < NUM_SRAM_REGIONS; i++)
+    {
+        if (heapStatistics.largestFree[i] > largest)
+            largest = heapStatistics.largestFree[i];
+    }
+    for (i = 0; i < HEAP_SIZE_CLASSES; i++)
+    {
+        failures += heapStatistics.failures[i];
+    }
+    kernelData.heapBytesInUse = heapStatistics.bytesInUse;
+    kernelData.heapLargestFree = largest;
+    kernelData.heapAllocations = heapStatistics.allocations;
+    kernelData.heapFailures = failures;
+    kernelData.heapFragmentation = heapStatistics.fragmentation;
+}
+
+// Publish the tick count and running task to the kernel data page
+// Called from systickIsr() and pendSvIsr(); readers retry while sequence is odd or changed
+void publishKernelPage(void)
+{
+    kernelData.sequence++;                          // Odd: update in progress
+    kernelData.tickCount = systemTickCount;
+    kernelData.taskCount = taskCount;
+    kernelData.taskCurrent = taskCurrent;
+    kernelData.criticalityMode = criticalityMode;
+    kernelData.modeSwitches = modeSwitches;
+    kernelData.switchCycles = switchCycles;
+    publishHeapStats();
+    kernelData.sequence++;                          // Even: page is consistent
+}
+
+// Publish the entry of one task to the kernel data page
+// Called when the state, priority or runtime of the task changes, so the tick
+// does not have to refresh every task
+void publishTask(uint8_t task)
+{
+    uint8_t type, id;
+    kernelData.sequence++;
+    kernelData.tasks[task].state = tcb[task].state;
+    kernelData.tasks[task].currentPriority = tcb[task].currentPriority;
+    kernelData.tasks[task].runtime = tcb[task].runtime;
+    kernelData.tasks[task].deadlineMisses = tcb[task].deadlineMisses;
+    if (tcb[task].budgetSlot != NO_SLOT)
+        kernelData.tasks[task].throttles = budgets[tcb[task].budgetSlot].throttles;
+    getBlockingResource(task, &type, &id);
+    kernelData.tasks[task].blockingResourceType = type;
+    kernelData.tasks[task].blockingResourceId = id;
+    kernelData.sequence++;
+}
+
+// Returns the name of a task, kept only in its kernel data page entry
+char * taskName(uint8_t task)
+{
+    return (char *)kernelData.tasks[task].name;
+}
+
+// Count a deadline miss if the current job of a task completes after its deadline
+void completeJob(uint8_t task)
+{
+    if (schedTasks[task].relativeDeadline && (int32_t)(systemTickCount - schedTasks[task].absoluteDeadline) > 0)
+    {
+        tcb[task].deadlineMisses++;
+    }
+}
+
+// Make a task ready to run
+// release starts a new job, so a deadline task gets a new absolute deadline; a task
+// handed a mutex it was waiting on continues its current job
+void readyTask(uint8_t task, bool release)
+{
+    schedHeapRemove(&sleepHeap, task);              // Woken on time or restarted while delayed
+    if (criticalityMode == CRITICALITY_HI && (tcb[task].flags & TASK_LO_CRITICALITY))
+    {
+        tcb[task].state = STATE_SUSPENDED;          // Held until the mode returns to low
+        if (release)
+            tcb[task].flags |= TASK_RELEASE_HELD;
+        publishTask(task);
+        return;
+    }
+    tcb[task].state = STATE_READY;
+    rescheduleRequested = true;
+    if (release)
+    {
+        schedTasks[task].absoluteDeadline = systemTickCount + schedTasks[task].relativeDeadline;
+        schedUpdate(task);                          // Requeue with the new deadline if already ready
+    }
+    if (!schedTasks[task].ready)
+    {
+        schedTasks[task].ready = true;
+        schedActive->onReady(task);
+    }
+    publishTask(task);
+}
+
+// Take a task out of the ready state
+// Waiting for a delay, semaphore, stream or timer ends the current job; blocking on a
+// mutex or being throttled does not, and a stopped task has no job to complete
+void blockTask(uint8_t task, uint8_t state)
+{
+    if (tcb[task].state == STATE_READY && state != STATE_BLOCKED_MUTEX && state != STATE_STOPPED && state != STATE_THROTTLED
+        && state != STATE_BLOCKED_RELEASE && state != STATE_SUSPENDED)
+    {
+        completeJob(task);
+    }
+    if (schedTasks[task].ready)
+    {
+        schedTasks[task].ready = false;
+        schedActive->onBlock(task);
+    }
+    schedHeapRemove(&sleepHeap, task);              // Stopped while delayed
+    if (state == STATE_STOPPED)
+    {
+        tcb[task].flags &= ~TASK_CYCLIC_JOB;        // A killed job is not an overrun
+    }
+    tcb[task].state = state;
+    publishTask(task);
+}
+
+// Block a task until systemTickCount reaches wakeTick
+void delayTask(uint8_t task, uint32_t wakeTick)
+{
+    blockTask(task, STATE_DELAYED);
+    tcb[task].wakeTick = wakeTick;
+    schedHeapUpdate(&sleepHeap, task);
+}
+
+// Enter high criticality mode when a high criticality task overruns its low mode
+// budget: suspend every ready low criticality task in one pass and let the task
+// continue on its high mode budget
+void enterHiMode(uint8_t task)
+{
+    uint8_t i;
+    struct _budget *b = &budgets[tcb[task].budgetSlot];
+    criticalityMode = CRITICALITY_HI;
+    modeTrigger = task;
+    modeSwitches++;
+    b->remaining = b->hiBudget - b->budget;
+    for (i = 0; i < taskCount; i++)
+    {
+        if ((tcb[i].flags & TASK_LO_CRITICALITY) && tcb[i].state == STATE_READY)
+        {
+            blockTask(i, STATE_SUSPENDED);
+        }
+    }
+}
+
+// Return to low criticality mode at the next budget period of the task that
+// caused the switch, and resume the suspended tasks where they left off
+// A task released while suspended, or a periodic task whose next release passed
+// while it was suspended, starts a new job instead: its deadline is recomputed and
+// a periodic task rejoins its release grid at the latest release point
+void exitHiMode(void)
+{
+    uint8_t i;
+    bool release;
+    uint32_t late;
+    criticalityMode = CRITICALITY_LO;
+    modeTrigger = 0xFF;
+    for (i = 0; i < taskCount; i++)
+    {
+        if (tcb[i].state == STATE_SUSPENDED)
+        {
+            release = (tcb[i].flags & TASK_RELEASE_HELD) != 0;
+            late = systemTickCount - tcb[i].nextRelease;
+            if (tcb[i].period != 0 && (int32_t)late >= (int32_t)tcb[i].period)
+            {
+                if (!release)
+                    completeJob(i);                 // The job in progress ran past its next release
+                tcb[i].nextRelease += late - late % tcb[i].period;
+                release = true;
+            }
+            tcb[i].flags &= ~TASK_RELEASE_HELD;
+            readyTask(i, release);
+        }
+    }
+}
+
+// Copy up to length bytes out of a stream buffer, returns the number of bytes copied
+uint16_t copyFromStream(uint8_t stream, uint8_t *buffer, uint16_t length)
+{
+    uint16_t n = 0;
+    while (n < length && streams[stream].count > 0)
+    {
+        buffer[n++] = streams[stream].data[streams[stream].tail];
+        streams[stream].tail = (streams[stream].tail + 1) % STREAM_BUFFER_SIZE;
+        streams[stream].count--;
+    }
+    streams[stream].bytesReceived += n;
+    if (n > 0)
+        streams[stream].wakeups++;
+    return n;
+}
+
+// Complete the receive of the task blocked on a stream and make it ready
+// Called with the trigger level reached (producer) or when the timeout expires (systick)
+void completeStreamReceive(uint8_t stream)
+{
+    uint8_t task = streams[stream].reader;
+    *streams[stream].readCount = copyFromStream(stream, streams[stream].readBuffer, streams[stream].readLength);
+    if (*streams[stream].readCount == 0)
+        streams[stream].emptyTimeouts++;            // Idle line, the reader gets nothing
+    streams[stream].reader = 0xFF;
+    readyTask(task, true);
+    tcb[task].stream = 0xFF;
+    tcb[task].ticks = 0;
+}
+
+// Returns true if timer a expires before timer b (tick counter wraps)
+bool timerBefore(uint8_t a, uint8_t b)
+{
+    return (int32_t)(timers[a].expiry - timers[b].expiry) < 0;
+}
+
+// Swap two entries of the timer heap and keep their heap indices in step
+void timerHeapSwap(uint8_t i, uint8_t j)
+{
+    uint8_t t = timerHeap[i];
+    timerHeap[i] = timerHeap[j];
+    timerHeap[j] = t;
+    timers[timerHeap[i]].heapIndex = i;
+    timers[timerHeap[j]].heapIndex = j;
+}
+
+// Move a timer towards the root while it expires before its parent
+void timerHeapUp(uint8_t i)
+{
+    while (i > 0 && timerBefore(timerHeap[i], timerHeap[(i - 1) / 2]))
+    {
+        timerHeapSwap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+// Move a timer towards the leaves while a child expires before it
+void timerHeapDown(uint8_t i)
+{
+    uint8_t smallest;
+    while (true)
+    {
+        smallest = i;
+        if (2 * i + 1 < timerHeapSize && timerBefore(timerHeap[2 * i + 1], timerHeap[smallest]))
+            smallest = 2 * i + 1;
+        if (2 * i + 2 < timerHeapSize && timerBefore(timerHeap[2 * i + 2], timerHeap[smallest]))
+            smallest = 2 * i + 2;
+        if (smallest == i)
+            break;
+        timerHeapSwap(i, smallest);
+        i = smallest;
+    }
+}
+
+// Arm a timer by adding it to the expiry heap
+void timerHeapInsert(uint8_t timer)
+{
+    timers[timer].heapIndex = timerHeapSize;
+    timerHeap[timerHeapSize++] = timer;
+    timerHeapUp(timers[timer].heapIndex);
+}
+
+// Disarm a timer by removing it from the expiry heap
+void timerHeapRemove(uint8_t timer)
+{
+    uint8_t i = timers[timer].heapIndex;
+    if (i == 0xFF)
+        return;
+    timerHeapSize--;
+    if (i != timerHeapSize)
+    {
+        timerHeapSwap(i, timerHeapSize);
+        timerHeapUp(i);
+        timerHeapDown(timers[timerHeap[i]].heapIndex);
+    }
+    timers[timer].heapIndex = 0xFF;
+}
+
+// Create a software timer whose callback runs in the timer service task
+// The timer is armed immediately when start is true, otherwise use startTimer()
+bool createTimer(uint8_t timer, _fn callback, uint32_t period, bool autoReload, bool start)
+{
+    bool ok = (timer < MAX_TIMERS) && (period > 0);
+    if (ok)
+    {
+        timerHeapRemove(timer);
+        timers[timer].callback = callback;
+        timers[timer].period = period;
+        timers[timer].autoReload = autoReload;
+        timers[timer].queued = false;
+        if (start)
+        {
+            timers[timer].expiry = systemTickCount + period;
+            timerHeapInsert(timer);
+        }
+    }
+    return ok;
+}
+
+// Timestamp the release of a task so its first dispatch can record the latency
+// The pool holds a record for every task slot, so a task is only unmeasured if
+// the pool could not be created
+void markRelease(uint8_t task)
+{
+    struct _jitter *stats = tcb[task].jitter;
+    if (stats == 0 && pools[JITTER_POOL] != 0)
+    {
+        stats = (struct _jitter *)poolAlloc(pools[JITTER_POOL]);
+        if (stats != 0)
+        {
+            stats->releases = 0;
+            stats->jitterMin = 0;
+            stats->jitterMax = 0;
+            stats->jitterSum = 0;
+            tcb[task].jitter = stats;
+        }
+    }
+    if (stats != 0)
+    {
+        stats->releaseTime = getTimestamp();
+        tcb[task].flags |= TASK_RELEASE_PENDING;
+    }
+}
+
+// Run the cyclic executive, called each tick from systickIsr()
+// At each minor frame boundary a cyclic task that has not called waitNextRelease()
+// overran the frame that just ended; then the table entries due at this tick are
+// released and a switch is forced so they start within the tick, with or without
+// preemption
+void processCyclicSchedule(void)
+{
+    uint8_t i, task;
+    if (minorFrameLength == 0)
+        return;
+    if (cyclicTick % minorFrameLength == 0)
+    {
+        uint8_t ended = (cyclicTick == 0 ? minorFramesPerMajor : cyclicTick / minorFrameLength) - 1;
+        for (i = 0; i < cyclicEntries; i++)
+        {
+            // Still in its job, whether running, preempted or blocked part way
+            if (tcb[cyclicTable[i].task].flags & TASK_CYCLIC_JOB)
+            {
+                frameOverruns[ended]++;
+                break;
+            }
+        }
+    }
+    while (cyclicNext < cyclicEntries && cyclicTable[cyclicNext].offset == cyclicTick)
+    {
+        task = cyclicTable[cyclicNext++].task;
+        if (tcb[task].state == STATE_BLOCKED_RELEASE)
+        {
+            readyTask(task, true);
+            markRelease(task);
+            tcb[task].flags |= TASK_CYCLIC_JOB;
+            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+        }
+    }
+    if (++cyclicTick == minorFrameLength * minorFramesPerMajor)
+    {
+        cyclicTick = 0;
+        cyclicNext = 0;
+        majorFrameCount++;
+    }
+}
+
+// Fire every timer that has reached its expiry, called each tick from systickIsr()
+// Expired timers are queued for the service task, auto-reload timers are re-armed
+void processTimers(void)
+{
+    uint8_t timer;
+    while (timerHeapSize > 0 && (int32_t)(systemTickCount - timers[timerHeap[0]].expiry) >= 0)
+    {
+        timer = timerHeap[0];
+        timerHeapRemove(timer);
+        if (!timers[timer].queued && timerQueueSize < MAX_TIMER_QUEUE_SIZE)
+        {
+            timerQueue[(timerQueueHead + timerQueueSize) % MAX_TIMER_QUEUE_SIZE] = timer;
+            timerQueueSize++;
+            timers[timer].queued = true;
+        }
+        if (timers[timer].autoReload)
+        {
+            timers[timer].expiry += timers[timer].period;   // Stay on the original grid
+            timerHeapInsert(timer);
+        }
+    }
+    // Hand the oldest expired callback to the service task if it is waiting
+    if (timerServiceTask != 0xFF && timerQueueSize > 0)
+    {
+        timer = timerQueue[timerQueueHead];
+        timerQueueHead = (timerQueueHead + 1) % MAX_TIMER_QUEUE_SIZE;
+        timerQueueSize--;
+        timers[timer].queued = false;
+        *timerServiceCallback = timers[timer].callback;
+        readyTask(timerServiceTask, true);
+        timerServiceTask = 0xFF;
+    }
+}
+
+// Take a consistent snapshot of the kernel data page
+// Runs in the calling task with plain loads, no SVC; retries if the kernel
+// updated the page while it was being copied
+void readKernelPage(kernelPage *copy)
+{
+    const volatile uint32_t *src = (const volatile uint32_t *)&kernelData;
+    uint32_t *dst = (uint32_t *)copy;
+    uint32_t sequence;
+    uint16_t i;
+    do
+    {
+        sequence = kernelData.sequence;
+        for (i = 0; i < sizeof(kernelPage) / sizeof(uint32_t); i++)
+        {
+            dst[i] = src[i];
+        }
+    } while ((sequence & 1) || sequence != kernelData.sequence);
+}
+
+// Record the release-to-dispatch latency of a task released from a delay
+void recordReleaseJitter(uint8_t task)
+{
+    struct _jitter *stats = tcb[task].jitter;
+    uint32_t jitter = (getTimestamp() - stats->releaseTime) / CYCLES_PER_US;
+    if (stats->releases == 0 || jitter < stats->jitterMin)
+        stats->jitterMin = jitter;
+    if (jitter > stats->jitterMax)
+        stats->jitterMax = jitter;
+    stats->jitterSum += jitter;
+    stats->releases++;
+    tcb[task].flags &= ~TASK_RELEASE_PENDING;
+}
 
 // Initialize the SysTick timer for periodic interrupts
 void initSystick(void)
@@ -139,196 +810,698 @@ void initRtos(void)
     uint8_t i;
     // no tasks running
     taskCount = 0;
+    schedInit();
     // clear out tcb records
     for (i = 0; i < MAX_TASKS; i++)
     {
         tcb[i].state = STATE_INVALID;               // Mark all TCBs as invalid
         tcb[i].pid = 0;                             // Clear the process ID (PID) for each task
+        tcb[i].budgetSlot = NO_SLOT;                // No budget and no jitter statistics
+        tcb[i].jitter = 0;
     }
+    // jitter records live in the heap rather than kernel RAM; the pool has no
+    // owner, so only the kernel can reach it
+    createPool(JITTER_POOL, sizeof(struct _jitter), MAX_TASKS, 0);
+    // no readers waiting on stream buffers
+    for (i = 0; i < MAX_STREAM_BUFFERS; i++)
+    {
+        streams[i].reader = 0xFF;
+    }
+    // no software timers armed
+    for (i = 0; i < MAX_TIMERS; i++)
+    {
+        timers[i].heapIndex = 0xFF;
+    }
+    // no tasks delayed
+    schedHeapInit(&sleepHeap);
+    // kernel RAM per task slot, reported by ps
+    kernelData.taskBytes = sizeof(struct _tcb) + sizeof(schedTask) + sizeof(kernelTaskInfo)
+                         + 2 * sizeof(uint8_t);     // sleepHeap task and position
+}
+
+// Select the next task to run with the active scheduling policy (see sched.h)
+// The running task keeps the processor until its time slice expires unless a
+// more urgent task is ready
+uint8_t selectNextTask(void)
+{
+    bool inSlice = (tcb[taskCurrent].state == STATE_READY && tcb[taskCurrent].sliceRemaining > 0);
+    uint8_t i;
+
+    // Released cyclic tasks take precedence over every policy, in table order;
+    // the dynamic policies only schedule the slack
+    if ((tcb[taskCurrent].flags & TASK_CYCLIC) && tcb[taskCurrent].state == STATE_READY)
+    {
+        return taskCurrent;
+    }
+    for (i = 0; i < cyclicEntries; i++)
+    {
+        if (tcb[cyclicTable[i].task].state == STATE_READY)
+        {
+            return cyclicTable[i].task;
+        }
+    }
+
+    return schedActive->pickNext(taskCurrent, inSlice);
 }
 
-// RTOS Scheduler to select the next task to run based on priority or round-robin
+// RTOS Scheduler to select the next task to run
+// Starts a new time slice when a different task is dispatched or the slice expired
 uint8_t rtosScheduler(void)
 {
-    static uint8_t lastTaskIndex = 0xFF;            // Keeps track of the last selected task for round-robin
+    uint8_t task = selectNextTask();
+    if (task != taskCurrent || tcb[task].sliceRemaining == 0)
+    {
+        tcb[task].sliceRemaining = tcb[task].quantum;
+    }
+    if (task != taskCurrent)
+    {
+        kernelData.contextSwitches++;
+    }
+    schedTasks[task].yielded = false;
+    rescheduleRequested = false;
+    return task;
+}
 
-    if (priorityScheduler)
+// Spawn a new thread to execute the given function
+// This function switches to unprivileged mode before executing the thread function
+void spawn(_fn fn)
+{
+    disablePrivilegedMode();                // Enable the TMPL bit in the CONTROL register
+    fn();                                   // Call the method
+}
+// start the operating system
+// by calling scheduler, set srd bits, setting PSP, ASP bit, call fn with fn add in R0
+// fn set TMPL bit, and PC <= fn
+void startRtos(void)
+{
+    static _fn fn;
+    taskCurrent = rtosScheduler();
+    if (tcb[taskCurrent].pid == 0)
     {
-        uint8_t highestPriority = NUM_PRIORITIES;
-        uint8_t selectedTask = 0xFF;
-        uint8_t i;
-        uint8_t count = 0;
-        uint8_t candidates[MAX_TASKS];              // Store tasks with the same priority
 
-        // Find the highest priority and collect all tasks with that priority
-        for (i = 0; i < MAX_TASKS; i++)
+        while (1);
+    }
+    void *taskPID = tcb[taskCurrent].pid;
+    fn = (_fn)taskPID;
+    writeMpuRegions(heapRegionBase, tcb[taskCurrent].mpuImage);   // Apply SRAM access mask based on the task's MPU configuration
+    startRtosAssembly((uint32_t)(tcb[taskCurrent].sp));// Call assembly function to set up and start the RTOS
+    spawn(fn);                                          // Spawn the selected task to execute its function in unprivileged mode
+}
+
+
+// Get the read-write (own memory, grants and writable segments) and read-only access masks of a task
+void getThreadAccess(uint8_t task, uint64_t *readWrite, uint64_t *readOnly)
+{
+    uint8_t s;
+    *readWrite = tcb[task].srd | tcb[task].granted;
+    *readOnly = 0;
+    for (s = 0; s < MAX_SHARED_SEGMENTS; s++)
+    {
+        if (tcb[task].sharedWrite & (1 << s))
+            *readWrite |= segments[s].mask;
+        else if (tcb[task].sharedRead & (1 << s))
+            *readOnly |= segments[s].mask;
+    }
+}
+
+// Rebuild the MPU image of a task after its memory or shared segments changed
+void updateThreadAccess(uint8_t task)
+{
+    uint64_t readWrite, readOnly;
+    getThreadAccess(task, &readWrite, &readOnly);
+    buildSramAccessImage(readWrite, readOnly, tcb[task].mpuImage);
+}
+
+// Allocate heap owned by a task outside the regions where it has read-only segments
+// (the MPU sets access per region, so memory there would be read-only too)
+// Blocks that land in such a region are held while the allocation is retried, so
+// the next attempt goes elsewhere, then released; returns 0 if none fits after
+// NUM_SRAM_REGIONS attempts
+void * mallocThreadMemory(uint8_t task, uint32_t size_in_bytes)
+{
+    void *rejected[NUM_SRAM_REGIONS];
+    uint8_t count = 0;
+    uint64_t readWrite, readOnly;
+    void *ptr = mallocFromHeap(size_in_bytes);
+    getThreadAccess(task, &readWrite, &readOnly);
+    while (ptr != 0 && sramMasksShareRegion(sramWindowMask((uint32_t *)ptr, heapAllocationBytes(ptr)), readOnly))
+    {
+        if (count == NUM_SRAM_REGIONS)
+        {
+            freeToHeap(ptr);
+            ptr = 0;
+        }
+        else
         {
-            if (tcb[i].state == STATE_READY)
+            rejected[count++] = ptr;
+            ptr = mallocFromHeap(size_in_bytes);
+        }
+    }
+    while (count > 0)
+    {
+        freeToHeap(rejected[--count]);
+    }
+    if (ptr != 0)
+        setHeapOwner(ptr, task);                    // Freed with the task if it is killed
+    return ptr;
+}
+
+// allocate stack space owned by the task and store top of stack in sp and spInit
+// set the srd bits based on the memory allocation
+// initialize the created stack to make it appear the thread has run before
+bool createThreadStack(uint8_t task)
+{
+    void *ptr = mallocThreadMemory(task, tcb[task].stackBytes);
+    if (ptr == 0)
+        return false;
+
+    tcb[task].sp = (void *)((uint32_t)ptr + tcb[task].stackBytes);
+    tcb[task].spInit = (void *)((uint32_t)ptr + tcb[task].stackBytes);
+    tcb[task].srd = setSramAccessWindow((uint32_t *)ptr, tcb[task].stackBytes);
+    updateThreadAccess(task);
+
+    // Create the initial stack frame
+    uint32_t *psp = (uint32_t *)tcb[task].sp;
+
+    // Simulate processor state (top of stack frame)
+    *(--psp) = 0x01000000;         // xPSR: Thumb mode
+    *(--psp) = (uint32_t)tcb[task].pid;    // PC: Task entry point
+    *(--psp) = 0xFFFFFFFD;         // LR: Return to Thread mode using PSP
+    *(--psp) = 0xFFFFFFFF;         // R12
+    *(--psp) = 0xFFFFFFFF;         // R3
+    *(--psp) = 0xFFFFFFFF;         // R2
+    *(--psp) = 0xFFFFFFFF;         // R1
+    *(--psp) = 0xFFFFFFFF;         // R0
+
+    // Update the TCB stack pointer
+    tcb[task].sp = (void *)((uint32_t)psp & ~0x7);
+    return true;
+}
+
+// free the stack and every heap block of a stopped thread and close its MPU window
+// Granted kernel memory and shared segments stay mapped for when the thread restarts
+void releaseThreadMemory(uint8_t task)
+{
+    freeHeapOwnedBy(task);
+    tcb[task].srd = createNoSramAccessMask();
+    updateThreadAccess(task);
+    tcb[task].sp = 0;
+    tcb[task].spInit = 0;
+}
+
+// add task if room in task list
+// store the thread name
+// create its stack (see createThreadStack)
+bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes)
+{
+    bool ok = false;
+    uint8_t i = 0;
+    bool found = false;
+    if (taskCount < MAX_TASKS)
+    {
+        // make sure fn not already in list (prevent reentrancy)
+        while (!found && (i < MAX_TASKS))
+        {
+            found = (tcb[i++].pid ==  fn);
+        }
+        if (!found)
+        {
+            // find first available tcb record
+            i = 0;
+            while (tcb[i].state != STATE_INVALID) {i++;}
+
+            tcb[i].pid = fn;
+            tcb[i].stackBytes = stackBytes;
+            if (!createThreadStack(i))
             {
-                if (tcb[i].currentPriority < highestPriority)
-                {
-                    highestPriority = tcb[i].currentPriority;
-                    count = 0;                           // Reset candidate count
-                }
-                if (tcb[i].currentPriority == highestPriority)
-                {
-                    candidates[count++] = i;            // Store the task index
-                }
+                tcb[i].pid = 0;
+                return false;
             }
+            tcb[i].priority = priority;
+            tcb[i].currentPriority = priority;
+            tcb[i].quantum = DEFAULT_QUANTUM;
+            schedTasks[i].priority = priority;
+            schedTasks[i].preemptThreshold = priority;
+            schedTasks[i].stride = STRIDE_ONE / DEFAULT_TICKETS;
+
+            // publish the static task details to the kernel data page
+            kernelData.tasks[i].pid = (uint32_t)fn;
+            manualStringCopy(taskName(i), name, sizeof(kernelData.tasks[i].name));
+
+            readyTask(i, true);
+
+            // increment task count
+            taskCount++;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Set the relative deadline (ticks) of a thread for EDF scheduling, 0 for none
+// Each release of the thread must complete within deadline ticks
+bool setThreadDeadline(_fn fn, uint32_t deadline)
+{
+    bool ok = false;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID)
+        {
+            schedTasks[i].relativeDeadline = deadline;
+            schedTasks[i].absoluteDeadline = systemTickCount + deadline;
+            schedUpdate(i);
+            kernelData.tasks[i].deadline = deadline;
+            ok = true;
         }
+    }
+    return ok;
+}
 
-        // If there are multiple tasks with the same priority, perform round-robin among them
-        if (count > 0)
+// Get the worst-case demand of a non-periodic task: load ticks of work released
+// at most once every interval ticks, up to jitter ticks late
+// A declared WCET (setThreadWcet) is used if there is one; otherwise a CPU budget
+// bounds the demand, as a release of the budget that may come period - budget
+// ticks late. Returns false if the task has neither.
+bool getThreadLoad(uint8_t task, uint32_t *load, uint32_t *interval, uint32_t *jitter)
+{
+    struct _budget *b;
+    if (tcb[task].wcet != 0)
+    {
+        *load = tcb[task].wcet;
+        *interval = tcb[task].interval;
+        *jitter = 0;
+        return true;
+    }
+    if (tcb[task].budgetSlot != NO_SLOT)
+    {
+        b = &budgets[tcb[task].budgetSlot];
+        *load = b->budget;
+        *interval = b->period;
+        *jitter = b->period - b->budget;
+        return true;
+    }
+    return false;
+}
+
+// Assign deadline-monotonic priorities to the periodic tasks and run a
+// response-time analysis on the set; candidate (0xFF for none) is included as
+// if it were already periodic. Returns false if any task can miss its deadline.
+// Non-periodic tasks at or above the priority a periodic task gets interfere with
+// it; the set is rejected if one of them has no known load (see getThreadLoad).
+bool analyzePeriodicTasks(uint8_t candidate, bool assign)
+{
+    uint8_t order[MAX_TASKS];
+    uint8_t count = 0;
+    uint8_t i, j, t;
+    uint32_t response, interference, load, interval, jitter;
+
+    // Collect the periodic tasks sorted by deadline (shortest first, stable)
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if ((tcb[i].period != 0 && tcb[i].state != STATE_INVALID) || i == candidate)
         {
-            // Ensure lastTaskIndex is valid
-            bool validLastTask = false;
-            if (lastTaskIndex != 0xFF)
+            j = count++;
+            while (j > 0 && schedTasks[order[j - 1]].relativeDeadline > schedTasks[i].relativeDeadline)
             {
-                for (i = 0; i < count; i++)
-                {
-                    if (candidates[i] == lastTaskIndex && tcb[lastTaskIndex].state == STATE_READY)
-                    {
-                        validLastTask = true;
-                        break;
-                    }
-                }
+                order[j] = order[j - 1];
+                j--;
             }
+            order[j] = i;
+        }
+    }
+    if (count > PERIODIC_PRIORITY_LOWEST - PERIODIC_PRIORITY_HIGHEST + 1)
+        return false;
 
-            // If lastTaskIndex is not valid, reset it
-            if (!validLastTask)
+    // Response time of each task: R = C + sum over higher priority tasks of ceil((R + J) / T) * C
+    for (i = 0; i < count; i++)
+    {
+        t = order[i];
+        response = tcb[t].wcet;
+        do
+        {
+            interference = response;
+            response = tcb[t].wcet;
+            for (j = 0; j < i; j++)
             {
-                lastTaskIndex = 0xFF;
+                response += ((interference + tcb[order[j]].period - 1) / tcb[order[j]].period) * tcb[order[j]].wcet;
             }
-
-            // Find the next task in the candidate list after lastTaskIndex
-            uint8_t startIndex = 0;
-            if (lastTaskIndex != 0xFF)
+            for (j = 0; j < MAX_TASKS; j++)
             {
-                for (i = 0; i < count; i++)
+                if (tcb[j].state != STATE_INVALID && tcb[j].period == 0 && j != candidate
+                    && tcb[j].priority <= PERIODIC_PRIORITY_HIGHEST + i)
                 {
-                    if (candidates[i] == lastTaskIndex)
-                    {
-                        startIndex = (i + 1) % count;           // Start from the next candidate
-                        break;
-                    }
+                    if (!getThreadLoad(j, &load, &interval, &jitter))
+                        return false;
+                    response += ((interference + jitter + interval - 1) / interval) * load;
                 }
             }
+        } while (response != interference && response <= schedTasks[t].relativeDeadline);
+        if (response > schedTasks[t].relativeDeadline)
+            return false;
+    }
 
-            selectedTask = candidates[startIndex];
-            lastTaskIndex = selectedTask;                       // Update the last selected task
+    if (assign)
+    {
+        for (i = 0; i < count; i++)
+        {
+            t = order[i];
+            tcb[t].priority = PERIODIC_PRIORITY_HIGHEST + i;
+            tcb[t].currentPriority = tcb[t].priority;
+            schedTasks[t].preemptThreshold = tcb[t].priority;
+            schedSetPriority(t, tcb[t].priority);
+            publishTask(t);
         }
+    }
+    return true;
+}
 
-        return selectedTask;
+// Create a periodic thread released every period ticks, which must complete its
+// wcet ticks of work within deadline ticks of each release (0 = period)
+// Priorities are assigned deadline-monotonic; the thread is rejected if the
+// resulting task set fails the response-time analysis
+bool createPeriodicThread(_fn fn, const char name[], uint32_t period, uint32_t wcet, uint32_t deadline, uint32_t stackBytes)
+{
+    bool ok;
+    uint8_t i;
+    if (deadline == 0)
+        deadline = period;
+    ok = (period > 0) && (wcet > 0) && (wcet <= deadline) && (deadline <= period);
+
+    // Check the task set with the new thread in a free tcb record before creating it
+    for (i = 0; ok && i < MAX_TASKS && tcb[i].state != STATE_INVALID; i++);
+    ok = ok && (i < MAX_TASKS);
+    if (ok)
+    {
+        tcb[i].period = period;
+        tcb[i].wcet = wcet;
+        schedTasks[i].relativeDeadline = deadline;
+        ok = analyzePeriodicTasks(i, false);
+        tcb[i].period = 0;
+        tcb[i].wcet = 0;
+        schedTasks[i].relativeDeadline = 0;
     }
-    else
+    ok = ok && createThread(fn, name, PERIODIC_PRIORITY_LOWEST, stackBytes);
+    if (ok)
     {
-        // Round-robin scheduling
-        bool ok;
-        static uint8_t task = 0xFF;
-        ok = false;
-        while (!ok)
+        tcb[i].period = period;
+        tcb[i].wcet = wcet;
+        tcb[i].nextRelease = systemTickCount;
+        setThreadDeadline(fn, deadline);
+        analyzePeriodicTasks(0xFF, true);
+    }
+    return ok;
+}
+
+// Declare the worst-case demand of a non-periodic thread: at most wcet ticks of
+// work per release, released no more often than every interval ticks
+// Needed for threads at or above the priorities of periodic threads, which count
+// them in their response-time analysis; fails if a periodic thread would miss
+// its deadline
+bool setThreadWcet(_fn fn, uint32_t wcet, uint32_t interval)
+{
+    bool ok = false;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID && tcb[i].period == 0
+            && wcet > 0 && wcet <= interval)
         {
-            task++;
-            if (task >= MAX_TASKS)
-                task = 0;
-            ok = (tcb[task].state == STATE_READY);
+            tcb[i].wcet = wcet;
+            tcb[i].interval = interval;
+            ok = analyzePeriodicTasks(0xFF, false);
+            if (!ok)
+            {
+                tcb[i].wcet = 0;
+                tcb[i].interval = 0;
+            }
         }
-        return task;
     }
+    return ok;
 }
 
-// Spawn a new thread to execute the given function
-// This function switches to unprivileged mode before executing the thread function
-void spawn(_fn fn)
+// function to block a periodic thread until its next release
+// Ends the current job; a thread that overran its period is released immediately
+void waitNextPeriod(void)
 {
-    disablePrivilegedMode();                // Enable the TMPL bit in the CONTROL register
-    fn();                                   // Call the method
+    __asm(" SVC #26");
 }
-// start the operating system
-// by calling scheduler, set srd bits, setting PSP, ASP bit, call fn with fn add in R0
-// fn set TMPL bit, and PC <= fn
-void startRtos(void)
+
+// Set the time slice of a thread in ticks
+// A thread runs for up to quantum ticks before an equal task gets the processor
+bool setThreadQuantum(_fn fn, uint32_t quantum)
 {
-    static _fn fn;
-    taskCurrent = rtosScheduler();
-    if (tcb[taskCurrent].pid == 0)
+    bool ok = false;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
     {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID && quantum > 0)
+        {
+            tcb[i].quantum = quantum;
+            ok = true;
+        }
+    }
+    return ok;
+}
 
-        while (1);
+// Set the tickets of a thread for stride scheduling
+// Ready threads of the same priority share the processor in proportion to their tickets
+bool setThreadTickets(_fn fn, uint32_t tickets)
+{
+    bool ok = false;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID && tickets > 0 && tickets <= STRIDE_ONE)
+        {
+            schedTasks[i].stride = STRIDE_ONE / tickets;
+            ok = true;
+        }
     }
-    void *taskPID = tcb[taskCurrent].pid;
-    fn = (_fn)taskPID;
-    applySramAccessMask(tcb[taskCurrent].srd);          // Apply SRAM access mask based on the task's MPU configuration
-    startRtosAssembly((uint32_t)(tcb[taskCurrent].sp));// Call assembly function to set up and start the RTOS
-    spawn(fn);                                          // Spawn the selected task to execute its function in unprivileged mode
+    return ok;
+}
+
+// Configure the cyclic executive: a major frame of minorFrames minor frames of
+// minorFrame ticks each, repeated from startRtos; 0 ticks turns it off
+// Call before addCyclicRelease()
+bool initCyclicSchedule(uint32_t minorFrame, uint8_t minorFrames)
+{
+    bool ok = (minorFrames > 0) && (minorFrames <= MAX_MINOR_FRAMES);
+    uint8_t i;
+    if (ok)
+    {
+        minorFrameLength = minorFrame;
+        minorFramesPerMajor = minorFrames;
+        cyclicEntries = 0;
+        cyclicTick = 0;
+        cyclicNext = 0;
+        for (i = 0; i < MAX_MINOR_FRAMES; i++)
+        {
+            frameOverruns[i] = 0;
+        }
+    }
+    return ok;
+}
+
+// Release a thread offset ticks into every major frame
+// The thread loops on waitNextRelease() and must finish within the minor frame
+// it was released in; a thread may appear at several offsets
+bool addCyclicRelease(_fn fn, uint32_t offset)
+{
+    bool ok = (minorFrameLength > 0) && (cyclicEntries < MAX_CYCLIC_ENTRIES)
+              && (offset < minorFrameLength * minorFramesPerMajor);
+    uint8_t i, j;
+    for (i = 0; ok && i < MAX_TASKS && !(tcb[i].pid == fn && tcb[i].state != STATE_INVALID); i++);
+    ok = ok && (i < MAX_TASKS);
+    if (ok)
+    {
+        // Keep the table sorted by offset so each tick checks only the next entry
+        j = cyclicEntries++;
+        while (j > 0 && cyclicTable[j - 1].offset > offset)
+        {
+            cyclicTable[j] = cyclicTable[j - 1];
+            j--;
+        }
+        cyclicTable[j].offset = offset;
+        cyclicTable[j].task = i;
+        tcb[i].flags |= TASK_CYCLIC;
+        if (tcb[i].state == STATE_READY)
+        {
+            blockTask(i, STATE_BLOCKED_RELEASE);    // First runs at its first table release
+        }
+    }
+    return ok;
+}
+
+// function to block a cyclic thread until the schedule table releases it again
+void waitNextRelease(void)
+{
+    __asm(" SVC #28");
+}
+
+// Set the preemption threshold of a thread (0=highest, no lower than its priority)
+// While running, the thread is only preempted by tasks with a higher priority than
+// the threshold; tasks sharing a threshold never preempt each other
+// Applies to the priority policy; a task that yields or blocks gives it up
+bool setThreadPreemptThreshold(_fn fn, uint8_t threshold)
+{
+    bool ok = false;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID && threshold <= tcb[i].priority)
+        {
+            schedTasks[i].preemptThreshold = threshold;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Limit a thread to budget ticks of CPU time in every period ticks
+// A thread that exhausts its budget is suspended (STATE_THROTTLED) until the
+// next replenishment, regardless of priority or preemption mode
+bool setThreadBudget(_fn fn, uint32_t budget, uint32_t period)
+{
+    bool ok = false;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID && budget > 0 && budget <= period)
+        {
+            if (tcb[i].budgetSlot == NO_SLOT)
+            {
+                if (budgetCount == MAX_BUDGETED_TASKS)
+                    break;
+                tcb[i].budgetSlot = budgetCount++;
+                budgets[tcb[i].budgetSlot].task = i;
+            }
+            budgets[tcb[i].budgetSlot].budget = budget;
+            budgets[tcb[i].budgetSlot].period = period;
+            budgets[tcb[i].budgetSlot].remaining = budget;
+            budgets[tcb[i].budgetSlot].replenish = systemTickCount + period;
+            kernelData.tasks[i].budget = budget;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Tag a thread with a criticality level
+// A high criticality thread with a budget may overrun it up to hiBudget ticks per
+// budget period; the overrun switches the kernel to high criticality mode, which
+// suspends the low criticality threads until the thread's next budget period
+bool setThreadCriticality(_fn fn, uint8_t criticality, uint32_t hiBudget)
+{
+    bool ok = false;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID && criticality <= CRITICALITY_HI
+            && (hiBudget == 0 || (criticality == CRITICALITY_HI && tcb[i].budgetSlot != NO_SLOT
+                                  && hiBudget >= budgets[tcb[i].budgetSlot].budget
+                                  && hiBudget <= budgets[tcb[i].budgetSlot].period)))
+        {
+            if (criticality == CRITICALITY_LO)
+                tcb[i].flags |= TASK_LO_CRITICALITY;
+            else
+                tcb[i].flags &= ~TASK_LO_CRITICALITY;
+            if (tcb[i].budgetSlot != NO_SLOT)
+                budgets[tcb[i].budgetSlot].hiBudget = hiBudget;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Add heap memory allocated at init time to the MPU window of a thread
+// The memory stays owned by the kernel, so the grant survives the thread being killed
+// Memory in a region where the thread has a read-only segment would be read-only
+// too, so such a grant fails
+bool grantThreadMemory(_fn fn, void *base, uint32_t size_in_bytes)
+{
+    bool ok = false;
+    uint64_t readWrite, readOnly;
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID)
+        {
+            getThreadAccess(i, &readWrite, &readOnly);
+            if (!sramMasksShareRegion(sramWindowMask((uint32_t *)base, size_in_bytes), readOnly))
+            {
+                addSramAccessWindow(&tcb[i].granted, (uint32_t *)base, size_in_bytes);
+                updateThreadAccess(i);
+                ok = true;
+            }
+        }
+    }
+    return ok;
+}
+
+// Allocate a named block of heap that threads can share without copies
+// The segment is cleared and owned by the kernel; map it with mapSharedSegment()
+bool createSharedSegment(uint8_t segment, const char name[], uint32_t size_in_bytes)
+{
+    bool ok = (segment < MAX_SHARED_SEGMENTS) && (segments[segment].base == 0);
+    uint32_t i;
+    if (ok)
+    {
+        segments[segment].base = mallocFromHeap(size_in_bytes);
+        ok = (segments[segment].base != 0);
+    }
+    if (ok)
+    {
+        for (i = 0; i < size_in_bytes; i++)
+        {
+            ((uint8_t *)segments[segment].base)[i] = 0;
+        }
+        manualStringCopy(segments[segment].name, (char *)name, sizeof(segments[segment].name));
+        segments[segment].size = size_in_bytes;
+        segments[segment].mask = sramWindowMask((uint32_t *)segments[segment].base, size_in_bytes);
+    }
+    return ok;
 }
 
-
-// add task if room in task list
-// store the thread name
-// allocate stack space and store top of stack in sp and spInit
-// set the srd bits based on the memory allocation
-// initialize the created stack to make it appear the thread has run before
-bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes)
+// Add a shared segment to the MPU window of a thread, read-only unless writable
+// The MPU sets access per region, so a thread cannot hold read-only and read-write
+// memory in the same heap region; such a mapping fails
+bool mapSharedSegment(uint8_t segment, _fn fn, bool writable)
 {
     bool ok = false;
-    uint8_t i = 0;
-    bool found = false;
-    if (taskCount < MAX_TASKS)
+    uint64_t readWrite, readOnly;
+    uint8_t i;
+    if (segment >= MAX_SHARED_SEGMENTS || segments[segment].base == 0)
+        return false;
+    for (i = 0; i < MAX_TASKS; i++)
     {
-        // make sure fn not already in list (prevent reentrancy)
-        while (!found && (i < MAX_TASKS))
-        {
-            found = (tcb[i++].pid ==  fn);
-        }
-        if (!found)
+        if (tcb[i].pid == fn && tcb[i].state != STATE_INVALID)
         {
-            // find first available tcb record
-            i = 0;
-            while (tcb[i].state != STATE_INVALID) {i++;}
-
-            void *ptr = mallocFromHeap(stackBytes);
-
-            tcb[i].state = STATE_READY;
-            tcb[i].pid = fn;
-            tcb[i].sp = (void *)((uint32_t)ptr + stackBytes);
-            tcb[i].spInit = (void *)((uint32_t)ptr + stackBytes);
-            tcb[i].priority = priority;
-            tcb[i].currentPriority = priority;
-            tcb[i].srd = setSramAccessWindow((uint32_t *)ptr, stackBytes);
-
-            uint8_t j;
-           for (j = 0; j < 15 && name[j] != '\0'; j++)
-           {
-               tcb[i].name[j] = name[j];
-           }
-           tcb[i].name[j] = '\0';
-
-           // Create the initial stack frame
-           uint32_t *psp = (uint32_t *)tcb[i].sp;
-
-           // Simulate processor state (top of stack frame)
-           *(--psp) = 0x01000000;         // xPSR: Thumb mode
-           *(--psp) = (uint32_t)tcb[i].pid;       // PC: Task entry point
-           *(--psp) = 0xFFFFFFFD;         // LR: Return to Thread mode using PSP
-           *(--psp) = 0xFFFFFFFF;         // R12
-           *(--psp) = 0xFFFFFFFF;         // R3
-           *(--psp) = 0xFFFFFFFF;         // R2
-           *(--psp) = 0xFFFFFFFF;         // R1
-           *(--psp) = 0xFFFFFFFF;         // R0
-
-
-           // Update the TCB stack pointer
-           tcb[i].sp = (void *)((uint32_t)psp & ~0x7);
-
-            // increment task count
-            taskCount++;
-            ok = true;
+            getThreadAccess(i, &readWrite, &readOnly);
+            if (writable)
+                readWrite |= segments[segment].mask;
+            else
+                readOnly |= segments[segment].mask;
+            if (!sramMasksShareRegion(readWrite, readOnly))
+            {
+                if (writable)
+                    tcb[i].sharedWrite |= 1 << segment;
+                else
+                    tcb[i].sharedRead |= 1 << segment;
+                updateThreadAccess(i);
+                ok = true;
+            }
         }
     }
     return ok;
 }
 
+// Look up a shared segment by name; base is 0 if the calling thread has no mapping
+void openSharedSegment(const char name[], void **base, uint32_t *size_in_bytes)
+{
+    __asm(" SVC #34");
+}
+
 // function to restart a thread
 void restartThread(_fn fn)
 {
@@ -361,6 +1534,21 @@ void sleep(uint32_t tick)
        __asm(" SVC #1"); // SVC #1 for yielding to the scheduler
 }
 
+// function to sleep until an absolute tick (*lastWake + period)
+// *lastWake is advanced by one period, so the release times of a periodic
+// task stay on a fixed grid regardless of its execution and preemption time
+void sleepUntil(uint32_t *lastWake, uint32_t period)
+{
+    __asm(" SVC #23");
+}
+
+// function to read the system tick count (1 ms ticks since startRtos)
+// a single aligned word of the kernel data page, so no SVC is needed
+void getTickCount(uint32_t *ticks)
+{
+    *ticks = kernelData.tickCount;
+}
+
 //function to lock a mutex using pendsv
 void lock(int8_t mutex)
 {
@@ -385,6 +1573,69 @@ void post(int8_t semaphore)
     __asm(" SVC #5");
 }
 
+// this function to receive a chunk from a stream buffer using pendsv
+// blocks until the trigger level is reached or the stream timeout expires
+// the number of bytes copied into buffer is returned through count
+void streamReceive(int8_t stream, void *buffer, uint16_t length, uint16_t *count)
+{
+    __asm(" SVC #19");
+}
+
+// this function to arm (or re-arm) a software timer one period from now
+void startTimer(int8_t timer)
+{
+    __asm(" SVC #21");
+}
+
+// this function to disarm a software timer
+void stopTimer(int8_t timer)
+{
+    __asm(" SVC #22");
+}
+
+// this function to wait for the next expired software timer
+// the callback of the expired timer is returned through callback
+void waitTimer(_fn *callback)
+{
+    __asm(" SVC #20");
+}
+
+// Timer service task
+// Runs the callbacks of all software timers so periodic work shares one stack
+void timerService(void)
+{
+    _fn callback;
+    while(true)
+    {
+        waitTimer(&callback);
+        callback();
+    }
+}
+
+// Called by interrupt handlers (e.g. UART RX) to push a byte into a stream buffer
+// The blocked reader is only woken once the trigger level is reached
+void streamSendFromIsr(uint8_t stream, uint8_t byte)
+{
+    if (streams[stream].count < STREAM_BUFFER_SIZE)
+    {
+        streams[stream].data[streams[stream].head] = byte;
+        streams[stream].head = (streams[stream].head + 1) % STREAM_BUFFER_SIZE;
+        streams[stream].count++;
+    }
+    else
+    {
+        streams[stream].overruns++;                 // Drop the byte, reader is too slow
+    }
+    if (streams[stream].reader != 0xFF && streams[stream].count >= streams[stream].triggerLevel)
+    {
+        completeStreamReceive(stream);
+        if (preemption)
+        {
+            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;   // Let the reader run if it has priority
+        }
+    }
+}
+
 // this function to add support for the system timer
 
 // System Tick Interrupt Service Routine (ISR)
@@ -393,28 +1644,85 @@ void post(int8_t semaphore)
 
 void systickIsr(void)
 {
-    uint8_t i;
-    for (i = 0; i < MAX_TASKS; i++)
+    uint8_t i, j;
+    systemTickCount++;
+    processCyclicSchedule();                        // Time-triggered releases first
+    processTimers();                                // Fire expired software timers
+    // Release the delayed tasks that are due, earliest first
+    while (sleepHeap.size > 0 && (int32_t)(systemTickCount - tcb[sleepHeap.task[0]].wakeTick) >= 0)
+    {
+        i = sleepHeap.task[0];
+        readyTask(i, true);                         // Also takes it off sleepHeap
+        markRelease(i);
+    }
+    // Check if a stream reader has timed out waiting for its trigger level
+    for (i = 0; i < MAX_STREAM_BUFFERS; i++)
+    {
+        if (streams[i].reader != 0xFF && tcb[streams[i].reader].ticks > 0)
         {
-            // Check if the task is delayed
-            if (tcb[i].state == STATE_DELAYED)
+            if (--tcb[streams[i].reader].ticks == 0)
             {
-                // Decrement the tick count
-
-                    tcb[i].ticks--;
-
-                    // If the tick count reaches zero, set the task to ready
-                    if (tcb[i].ticks == 0)
-                    {
-                        tcb[i].state = STATE_READY;
-                    }
-
+                completeStreamReceive(i);           // Hand over whatever has arrived
+            }
+        }
+    }
+    // Replenish the CPU budgets at the start of each budget period
+    for (j = 0; j < budgetCount; j++)
+    {
+        i = budgets[j].task;
+        if ((int32_t)(systemTickCount - budgets[j].replenish) >= 0)
+        {
+            budgets[j].remaining = budgets[j].budget;
+            budgets[j].replenish += budgets[j].period;
+            if (i == modeTrigger)
+            {
+                exitHiMode();                       // The overload has cleared
+            }
+            if (tcb[i].state == STATE_THROTTLED)
+            {
+                readyTask(i, false);                // Resume where it was suspended
             }
         }
+    }
+    schedActive->onTick(taskCurrent);               // Let the policy account for the running task
+    // Charge the tick to the running task; once its budget is exhausted suspend it
+    // until replenishment and switch away even if preemption is off
+    j = tcb[taskCurrent].budgetSlot;
+    if (j != NO_SLOT && tcb[taskCurrent].state == STATE_READY)
+    {
+        if (budgets[j].remaining > 0)
+        {
+            budgets[j].remaining--;
+        }
+        if (budgets[j].remaining == 0)
+        {
+            if (criticalityMode == CRITICALITY_LO && !(tcb[taskCurrent].flags & TASK_LO_CRITICALITY)
+                && budgets[j].hiBudget > budgets[j].budget)
+            {
+                enterHiMode(taskCurrent);           // Keep running, shed the low criticality load
+            }
+            else
+            {
+                budgets[j].throttles++;
+                blockTask(taskCurrent, STATE_THROTTLED);
+            }
+            NVIC_INT_CTRL_R     |= NVIC_INT_CTRL_PEND_SV;
+        }
+    }
+    publishKernelPage();
+
     if(preemption)      // Check if preemption is enabled
     {
-        // Trigger the PendSV interrupt to perform a context switch
-        NVIC_INT_CTRL_R     |= NVIC_INT_CTRL_PEND_SV;
+        // Switch only when the time slice expires or a task was woken
+        if (tcb[taskCurrent].sliceRemaining > 0)
+        {
+            tcb[taskCurrent].sliceRemaining--;
+        }
+        if (tcb[taskCurrent].sliceRemaining == 0 || rescheduleRequested)
+        {
+            // Trigger the PendSV interrupt to perform a context switch
+            NVIC_INT_CTRL_R     |= NVIC_INT_CTRL_PEND_SV;
+        }
     }
 
 
@@ -423,30 +1731,34 @@ void systickIsr(void)
 
 
 // in coop and preemptive, this function to add support for task switching
-void pendSvIsr(void)
+// Called by pendSvIsr (Registers.s), which saves and restores R4-R11 around it
+void pendSvSwitch(void)
 {
+    uint32_t switchStart = WTIMER1_TAV_R;              // Cycle count of the switch
     WTIMER0_CTL_R &= ~TIMER_CTL_TAEN;                  // Stop the timer
     tcb[taskCurrent].runtime += WTIMER0_TAV_R;         // Accumulate runtime for the current task
     WTIMER0_TAV_R = 0;
-    __asm(" MRS     R0, PSP");                              // Load the PSP into a local register in the stack frame
-    __asm(" STMDB   R0, {R4-R11, LR}");                     // Store registers R4-R11 and LR in the stack frame
 
     tcb[taskCurrent].sp = (void *)((uint32_t)getPSP() & ~0x7);                 // Store the PSP to the sp of the current task
+    publishTask(taskCurrent);                              // Runtime and blocking resource of the outgoing task
 
 
 
     taskCurrent = rtosScheduler();
-    applySramAccessMask(tcb[taskCurrent].srd);                    // Apply the SRD rules specific to the first thread
+    if (tcb[taskCurrent].flags & TASK_RELEASE_PENDING)
+    {
+        recordReleaseJitter(taskCurrent);                  // First dispatch since leaving a delay
+    }
+    publishKernelPage();                                   // Expose the new state to tasks
+#if defined(MPU_SWITCH_BY_REGION)
+    writeMpuRegionsByNumber(tcb[taskCurrent].mpuImage);    // Previous path, kept to compare switch times
+#else
+    writeMpuRegions(heapRegionBase, tcb[taskCurrent].mpuImage);   // Store the task's heap region attributes in one burst
+#endif
     setPSP((uint32_t)tcb[taskCurrent].sp);                 // Load the new PSP and execute
 
     WTIMER0_CTL_R |= TIMER_CTL_TAEN;                   // Start the timer for the new task
-
-
-    __asm(" MRS     R1, PSP");                      // Load the PSP into a local register
-    __asm(" SUBS    R1, #0x24");                    // Go down 9 registers and pop from there
-    __asm(" LDMIA   R1!, {R4-R11, LR}");            // Load registers R4-R11 from the stack
-
-
+    switchCycles = WTIMER1_TAV_R - switchStart;        // Published with the next kernel page update
 }
 
 // this function to add support for the service call
@@ -460,15 +1772,16 @@ void svCallIsr(void)
     switch (svcNumber)
     {
         case 0: // Yield SVC
+            tcb[taskCurrent].sliceRemaining = 0;                   // Give up the rest of the time slice
+            schedTasks[taskCurrent].yielded = true;                       // and any preemption threshold
             NVIC_INT_CTRL_R     |= NVIC_INT_CTRL_PEND_SV;         // Trigger the PendSV interrupt to perform a context switch
             break;
 
         case 1: // SVC #1: Sleep request
             // Retrieve the tick count from R0
 
-            // Set the task's ticks and mark it as delayed in TCB
-            tcb[taskCurrent].ticks = moveToRegisterR0();
-            tcb[taskCurrent].state = STATE_DELAYED;
+            // Mark the task as delayed until its wake tick
+            delayTask(taskCurrent, systemTickCount + moveToRegisterR0());
 
             NVIC_INT_CTRL_R     |= NVIC_INT_CTRL_PEND_SV;        // Trigger the PendSV interrupt to perform a context switch
 
@@ -493,7 +1806,7 @@ void svCallIsr(void)
                         mutexes[mutexId].queueSize++;
 
                         // Block the current task on this mutex
-                        tcb[taskCurrent].state = STATE_BLOCKED_MUTEX;
+                        blockTask(taskCurrent, STATE_BLOCKED_MUTEX);
                         tcb[taskCurrent].mutex = mutexId;
 
 
@@ -527,7 +1840,7 @@ void svCallIsr(void)
                     }
                     mutexes[mutexId].queueSize--;
 
-                    tcb[nextTask].state = STATE_READY;
+                    readyTask(nextTask, false);
                     mutexes[mutexId].lock = true;
                     mutexes[mutexId].lockedBy = nextTask;
                 }
@@ -549,7 +1862,7 @@ void svCallIsr(void)
             {
                 // Block the current task
                 semaphores[semaphoreId].processQueue[semaphores[semaphoreId].queueSize++] = taskCurrent;
-                tcb[taskCurrent].state = STATE_BLOCKED_SEMAPHORE;
+                blockTask(taskCurrent, STATE_BLOCKED_SEMAPHORE);
                 tcb[taskCurrent].semaphore = semaphoreId; // Store semaphore causing block
 
                 NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
@@ -572,7 +1885,7 @@ void svCallIsr(void)
                 semaphores[semaphoreId].queueSize--;
 
                 // Set the task to READY state
-                tcb[nextTask].state = STATE_READY;
+                readyTask(nextTask, true);
                 tcb[nextTask].semaphore = 0xFF; // Clear semaphore blocking info
             }
             else
@@ -598,20 +1911,14 @@ void svCallIsr(void)
             NVIC_INT_CTRL_R     |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
             break;
         }
-        case 7:     // priorityScheduler SVC
+        case 7:     // scheduler policy SVC
         {
-            volatile bool schedulerMode = (bool)moveToRegisterR0();
+            volatile uint8_t policy = (uint8_t)moveToRegisterR0();
 
-            // Update the global variable
-            priorityScheduler = schedulerMode;
-            if(priorityScheduler)
-            {
-                putsUart0("priorityScheduler on");
-            }
-            if(!priorityScheduler)
-            {
-                putsUart0("priorityScheduler off");
-            }
+            // Switch policy and hand it the ready tasks
+            schedSetPolicy(policy);
+            putsUart0("sched ");
+            putsUart0((char *)schedActive->name);
             NVIC_INT_CTRL_R     |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
             break;
 
@@ -623,7 +1930,7 @@ void svCallIsr(void)
 
             for (i = 0; i < MAX_TASKS; i++) // Iterate over all tasks
             {
-                if (compare_string(tcb[i].name, procName)) // Match the function name in the TCB
+                if (compare_string(taskName(i), procName)) // Match the task name
                 {
                     uint8_t mutexId = tcb[i].mutex;
 
@@ -647,7 +1954,7 @@ void svCallIsr(void)
                             mutexes[mutexId].queueSize--; // Decrement queue size
 
                             // Assign mutex to the next task in the queue
-                            tcb[nextTask].state = STATE_READY;
+                            readyTask(nextTask, false);
                             mutexes[mutexId].lock = true;
                             mutexes[mutexId].lockedBy = nextTask;
                         }
@@ -691,11 +1998,25 @@ void svCallIsr(void)
                         }
                     }
 
+                    // If the task is waiting on a stream buffer, cancel the pending receive
+                    if (tcb[i].state == STATE_BLOCKED_STREAM)
+                    {
+                        streams[tcb[i].stream].reader = 0xFF;
+                        tcb[i].stream = 0xFF;
+                    }
+
+                    // If the task is the blocked timer service, stop handing it callbacks
+                    if (tcb[i].state == STATE_BLOCKED_TIMER)
+                    {
+                        timerServiceTask = 0xFF;
+                    }
+
                     // Mark the thread as stopped and clear its TCB values
-                    tcb[i].state = STATE_STOPPED;
+                    blockTask(i, STATE_STOPPED);
                     tcb[i].mutex = 0;
                     tcb[i].semaphore = 0;
                     tcb[i].ticks = 0;
+                    releaseThreadMemory(i);
 
                     break;
                 }
@@ -735,7 +2056,7 @@ void svCallIsr(void)
                             mutexes[mutexId].queueSize--; // Decrement queue size
 
                             // Assign mutex to the next task in the queue
-                            tcb[nextTask].state = STATE_READY;
+                            readyTask(nextTask, false);
                             mutexes[mutexId].lock = true;
                             mutexes[mutexId].lockedBy = nextTask;
                         }
@@ -779,11 +2100,25 @@ void svCallIsr(void)
                         }
                     }
 
+                    // If the task is waiting on a stream buffer, cancel the pending receive
+                    if (tcb[i].state == STATE_BLOCKED_STREAM)
+                    {
+                        streams[tcb[i].stream].reader = 0xFF;
+                        tcb[i].stream = 0xFF;
+                    }
+
+                    // If the task is the blocked timer service, stop handing it callbacks
+                    if (tcb[i].state == STATE_BLOCKED_TIMER)
+                    {
+                        timerServiceTask = 0xFF;
+                    }
+
                     // Mark the thread as stopped and clear its TCB values
-                    tcb[i].state = STATE_STOPPED;
+                    blockTask(i, STATE_STOPPED);
                     tcb[i].mutex = 0;
                     tcb[i].semaphore = 0;
                     tcb[i].ticks = 0;
+                    releaseThreadMemory(i);
 
                     break;
                 }
@@ -801,7 +2136,7 @@ void svCallIsr(void)
             // Search for the task by name
             for (i = 0; i < MAX_TASKS; i++)
             {
-                if (compare_string(tcb[i].name, proc_name))
+                if (compare_string(taskName(i), proc_name))
                 {
                     pid = (uint32_t)tcb[i].pid; // Get the PID of the matching task
                     itoa(pid, itoa_str);
@@ -819,7 +2154,11 @@ void svCallIsr(void)
             {
                 if((uint32_t)tcb[i].pid == pid)
                 {
-                    tcb[i].state = STATE_READY;                                             // Update the state to ready
+                    // A stopped thread starts over on a new stack; it stays stopped if there is no memory
+                    if (tcb[i].state == STATE_STOPPED && !createThreadStack(i))
+                        break;
+                    readyTask(i, true);                                                     // Update the state to ready
+                    tcb[i].nextRelease = systemTickCount;                                   // Periodic tasks restart their release grid
                     break;
 
                 }
@@ -832,12 +2171,14 @@ void svCallIsr(void)
         {
             uint32_t cppid = (uint32_t)moveToRegisterR0();
             uint32_t *psp = (uint32_t *)getPSP();
-            uint32_t priority = *(psp + 1);
+            uint8_t priority = (uint8_t)*(psp + 1);
             for(i = 0; i < MAX_TASKS; i++)
             {
                 if((uint32_t)tcb[i].pid == cppid)
                 {
                     tcb[i].currentPriority = priority;
+                    schedSetPriority(i, priority);          // Requeue under the new priority
+                    publishTask(i);
                     break;
 
                 }
@@ -878,6 +2219,18 @@ void svCallIsr(void)
                 }
             }
 
+            // Copy stream buffer data
+            for (i = 0; i < MAX_STREAM_BUFFERS; i++)
+            {
+                userIPCSInfo->streams[i].count = streams[i].count;
+                userIPCSInfo->streams[i].triggerLevel = streams[i].triggerLevel;
+                userIPCSInfo->streams[i].reader = streams[i].reader;
+                userIPCSInfo->streams[i].bytesReceived = streams[i].bytesReceived;
+                userIPCSInfo->streams[i].wakeups = streams[i].wakeups;
+                userIPCSInfo->streams[i].emptyTimeouts = streams[i].emptyTimeouts;
+                userIPCSInfo->streams[i].overruns = streams[i].overruns;
+            }
+
 
             break;
         }
@@ -886,9 +2239,13 @@ void svCallIsr(void)
             char *proc_name = (char *)moveToRegisterR0();
             for(i = 0; i < taskCount; i++)
             {
-                if(compare_string(tcb[i].name, proc_name))
+                if(compare_string(taskName(i), proc_name))
                 {
-                    tcb[i].state = STATE_READY;                                             // Update the state to ready
+                    // A stopped thread starts over on a new stack; it stays stopped if there is no memory
+                    if (tcb[i].state == STATE_STOPPED && !createThreadStack(i))
+                        break;
+                    readyTask(i, true);                                                     // Update the state to ready
+                    tcb[i].nextRelease = systemTickCount;                                   // Periodic tasks restart their release grid
                     break;
 
                 }
@@ -903,64 +2260,303 @@ void svCallIsr(void)
             uint32_t *psp = (uint32_t*) getPSP();
             void** ptr1 = (void **)*(psp + 1);
 
-            void *allocated = mallocFromHeap(size_in_bytes); // Perform allocation
+            void *allocated = mallocThreadMemory(taskCurrent, size_in_bytes); // Perform allocation
             *ptr1 = allocated;
 
-            uint64_t srdBitMask = setSramAccessWindow((uint32_t *)ptr1, size_in_bytes);
-            applySramAccessMask(srdBitMask);
+            // Add the block to the caller's access mask, kept across context switches
+            // The window is the block actually allocated (whole subregions), never the
+            // requested size, so it cannot reach past the block
+            if (allocated != 0)
+            {
+                addSramAccessWindow(&tcb[taskCurrent].srd, (uint32_t *)allocated, heapAllocationBytes(allocated));
+                updateThreadAccess(taskCurrent);
+                writeMpuRegions(heapRegionBase, tcb[taskCurrent].mpuImage);
+            }
             break;
 
         }
         case 17: // freeToHeap
         {
             void* pMemory = (void*)moveToRegisterR0(); // Retrieve pointer from R0
-            freeToHeap(pMemory); // Perform memory deallocation
+            if (getHeapOwner(pMemory) == taskCurrent)       // Tasks may only free their own blocks
+            {
+                // Close the block in the caller's access mask before it can be reused
+                removeSramAccessWindow(&tcb[taskCurrent].srd, (uint32_t *)pMemory, heapAllocationBytes(pMemory));
+                updateThreadAccess(taskCurrent);
+                writeMpuRegions(heapRegionBase, tcb[taskCurrent].mpuImage);
+                freeToHeap(pMemory); // Perform memory deallocation
+            }
             //moveToRegisterR0WithValue(1); // Indicate success (e.g., 1 = success)
             break;
         }
-        case 18: // ps command
+        case 19: // stream receive
         {
-            PSInfo *psInfo = (PSInfo *)moveToRegisterR0();  // Get pointer to PSInfo structure
+            uint32_t *psp = (uint32_t *)getPSP();
+            uint32_t streamId = psp[0];
+            uint8_t *buffer = (uint8_t *)psp[1];
+            uint16_t length = psp[2];
+            uint16_t *count = (uint16_t *)psp[3];
 
-            // Populate process information
-            psInfo->taskCount = taskCount;
-            uint32_t totalRuntime = 0;
+            if (streamId >= MAX_STREAM_BUFFERS || streams[streamId].triggerLevel == 0)
+            {
+                // No such stream, or it was never initialized
+                *count = 0;
+            }
+            else if (streams[streamId].count >= streams[streamId].triggerLevel)
+            {
+                // Enough data already buffered, no need to block
+                *count = copyFromStream(streamId, buffer, length);
+            }
+            else if (streams[streamId].reader != 0xFF)
+            {
+                // Stream buffers have a single reader, refuse a second one
+                *count = 0;
+            }
+            else
+            {
+                // Block until the producer reaches the trigger level or the timeout expires
+                streams[streamId].reader = taskCurrent;
+                streams[streamId].readBuffer = buffer;
+                streams[streamId].readLength = length;
+                streams[streamId].readCount = count;
+                blockTask(taskCurrent, STATE_BLOCKED_STREAM);
+                tcb[taskCurrent].stream = streamId;
+                tcb[taskCurrent].ticks = streams[streamId].timeout;
 
-            // Calculate total runtime
-            for (i = 0; i < taskCount; i++)
-                totalRuntime += tcb[i].runtime;
+                NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
+            }
+            break;
+        }
+        case 20: // wait for an expired software timer
+        {
+            _fn *callback = (_fn *)moveToRegisterR0();
+            if (timerQueueSize > 0)
+            {
+                // A timer already expired, run its callback without blocking
+                uint8_t timer = timerQueue[timerQueueHead];
+                timerQueueHead = (timerQueueHead + 1) % MAX_TIMER_QUEUE_SIZE;
+                timerQueueSize--;
+                timers[timer].queued = false;
+                *callback = timers[timer].callback;
+            }
+            else
+            {
+                // Block until processTimers() hands over the next callback
+                timerServiceTask = taskCurrent;
+                timerServiceCallback = callback;
+                blockTask(taskCurrent, STATE_BLOCKED_TIMER);
 
-            // Fill process details
-            for (i = 0; i < taskCount; i++)
+                NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
+            }
+            break;
+        }
+        case 21: // start software timer
+        {
+            uint8_t timer = moveToRegisterR0();
+            if (timer < MAX_TIMERS && timers[timer].callback != 0)
+            {
+                timerHeapRemove(timer);
+                timers[timer].expiry = systemTickCount + timers[timer].period;
+                timerHeapInsert(timer);
+            }
+            break;
+        }
+        case 22: // stop software timer
+        {
+            uint8_t timer = moveToRegisterR0();
+            if (timer < MAX_TIMERS)
+            {
+                timerHeapRemove(timer);
+            }
+            break;
+        }
+        case 23: // sleep until an absolute tick
+        {
+            uint32_t *psp = (uint32_t *)getPSP();
+            uint32_t *lastWake = (uint32_t *)psp[0];
+            uint32_t period = psp[1];
+            int32_t remaining;
+
+            *lastWake += period;
+            remaining = (int32_t)(*lastWake - systemTickCount);
+            if (remaining > 0)
             {
-                psInfo->tasks[i].pid = (uint32_t)tcb[i].pid;
-                manualStringCopy(psInfo->tasks[i].name, tcb[i].name, sizeof(psInfo->tasks[i].name));
-                psInfo->tasks[i].state = tcb[i].state;
+                delayTask(taskCurrent, *lastWake);
 
-                // Calculate CPU percentage
-                if (totalRuntime > 0)
-                    psInfo->tasks[i].cpuPercent = (tcb[i].runtime * 100) / totalRuntime;
-                else
-                    psInfo->tasks[i].cpuPercent = 0;
+                NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
+            }
+            else
+            {
+                // The task overran its period and is released again immediately
+                completeJob(taskCurrent);
+                readyTask(taskCurrent, true);
+            }
+            break;
+        }
+        case 25: // release jitter statistics
+        {
+            JitterInfo *jitterInfo = (JitterInfo *)moveToRegisterR0();
 
-                // Determine blocking resource
-                if (tcb[i].state == STATE_BLOCKED_MUTEX)
+            jitterInfo->taskCount = taskCount;
+            for (i = 0; i < taskCount; i++)
+            {
+                manualStringCopy(jitterInfo->tasks[i].name, taskName(i), sizeof(jitterInfo->tasks[i].name));
+                jitterInfo->tasks[i].releases = 0;
+                jitterInfo->tasks[i].minJitter = 0;
+                jitterInfo->tasks[i].maxJitter = 0;
+                jitterInfo->tasks[i].avgJitter = 0;
+                if (tcb[i].jitter != 0 && tcb[i].jitter->releases > 0)
                 {
-                    psInfo->tasks[i].blockingResourceType = 1;
-                    psInfo->tasks[i].blockingResourceId = tcb[i].mutex;
+                    struct _jitter *stats = tcb[i].jitter;
+                    jitterInfo->tasks[i].releases = stats->releases;
+                    jitterInfo->tasks[i].minJitter = stats->jitterMin;
+                    jitterInfo->tasks[i].maxJitter = stats->jitterMax;
+                    jitterInfo->tasks[i].avgJitter = stats->jitterSum / stats->releases;
                 }
-                else if (tcb[i].state == STATE_BLOCKED_SEMAPHORE)
+            }
+            break;
+        }
+        case 26: // wait for the next release of a periodic task
+        {
+            int32_t remaining;
+
+            tcb[taskCurrent].nextRelease += tcb[taskCurrent].period;
+            remaining = (int32_t)(tcb[taskCurrent].nextRelease - systemTickCount);
+            if (tcb[taskCurrent].period != 0 && remaining > 0)
+            {
+                delayTask(taskCurrent, tcb[taskCurrent].nextRelease);
+
+                NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
+            }
+            else
+            {
+                // The task overran its period (or is not periodic) and is released again immediately
+                completeJob(taskCurrent);
+                readyTask(taskCurrent, true);
+            }
+            break;
+        }
+        case 27: // set the time slice of a task by name
+        {
+            uint32_t *psp = (uint32_t *)getPSP();
+            char *proc_name = (char *)psp[0];
+            uint32_t quantum = psp[1];
+            for (i = 0; i < taskCount; i++)
+            {
+                if (compare_string(taskName(i), proc_name) && quantum > 0)
                 {
-                    psInfo->tasks[i].blockingResourceType = 2;
-                    psInfo->tasks[i].blockingResourceId = tcb[i].semaphore;
+                    tcb[i].quantum = quantum;
+                    break;
                 }
-                else
+            }
+            break;
+        }
+        case 28: // wait for the next cyclic executive release
+        {
+            tcb[taskCurrent].flags &= ~TASK_CYCLIC_JOB;     // The job completed
+            blockTask(taskCurrent, STATE_BLOCKED_RELEASE);
+            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;       // Trigger the PendSV interrupt to perform a context switch
+            break;
+        }
+        case 29: // cyclic executive frame statistics
+        {
+            FrameInfo *frameInfo = (FrameInfo *)moveToRegisterR0();
+
+            frameInfo->minorFrame = minorFrameLength;
+            frameInfo->minorFrames = minorFramesPerMajor;
+            frameInfo->entries = cyclicEntries;
+            frameInfo->majorFrames = majorFrameCount;
+            for (i = 0; i < MAX_MINOR_FRAMES; i++)
+            {
+                frameInfo->overruns[i] = frameOverruns[i];
+            }
+            break;
+        }
+        case 30: // open a pool owned by the calling task
+        {
+            uint32_t *psp = (uint32_t *)getPSP();
+            uint8_t pool = psp[0];
+            memoryPool **handle = (memoryPool **)psp[1];
+
+            if (pool < MAX_POOLS && pools[pool] != 0 && pools[pool]->owner == tcb[taskCurrent].pid)
+                *handle = pools[pool];
+            else
+                *handle = 0;
+            break;
+        }
+        case 31: // pool statistics
+        {
+            PoolInfo *poolInfo = (PoolInfo *)moveToRegisterR0();
+
+            for (i = 0; i < MAX_POOLS; i++)
+            {
+                memoryPool *p = pools[i];
+                poolInfo->pools[i].blockSize = p ? p->blockSize : 0;
+                poolInfo->pools[i].blockCount = p ? p->blockCount : 0;
+                poolInfo->pools[i].used = p ? p->used : 0;
+                poolInfo->pools[i].highWater = p ? p->highWater : 0;
+                poolInfo->pools[i].failures = p ? p->failures : 0;
+                poolInfo->pools[i].owner[0] = '\0';
+                for (j = 0; p != 0 && p->owner != 0 && j < MAX_TASKS; j++)
                 {
-                    psInfo->tasks[i].blockingResourceType = 0;
-                    psInfo->tasks[i].blockingResourceId = 0xFF;
+                    if (tcb[j].pid == p->owner)
+                        manualStringCopy(poolInfo->pools[i].owner, taskName(j), sizeof(poolInfo->pools[i].owner));
                 }
             }
+            break;
+        }
+        case 32: // heap memory owned by each task
+        {
+            MemInfo *memInfo = (MemInfo *)moveToRegisterR0();
+
+            memInfo->taskCount = taskCount;
+            for (i = 0; i < taskCount; i++)
+            {
+                manualStringCopy(memInfo->tasks[i].name, taskName(i), sizeof(memInfo->tasks[i].name));
+                memInfo->tasks[i].state = tcb[i].state;
+                memInfo->tasks[i].stackBytes = tcb[i].stackBytes;
+                memInfo->tasks[i].bytes = heapOwnedBytes(i, &memInfo->tasks[i].blocks);
+            }
+            memInfo->kernelBytes = heapOwnedBytes(HEAP_OWNER_KERNEL, &j);
+            memInfo->freeBytes = heapFreeBytes();
+            break;
+        }
+        case 33: // heap statistics
+        {
+            HeapInfo *heapInfo = (HeapInfo *)moveToRegisterR0();
+
+            heapInfo->allocations = heapStatistics.allocations;
+            heapInfo->frees = heapStatistics.frees;
+            for (i = 0; i < HEAP_SIZE_CLASSES; i++)
+            {
+                heapInfo->failures[i] = heapStatistics.failures[i];
+            }
+            heapInfo->bytesInUse = heapStatistics.bytesInUse;
+            for (i = 0; i < NUM_SRAM_REGIONS; i++)
+            {
+                heapInfo->largestFree[i] = heapStatistics.largestFree[i];
+            }
+            heapInfo->fragmentation = heapStatistics.fragmentation;
+            break;
+        }
+        case 34: // open a shared segment by name
+        {
+            uint32_t *psp = (uint32_t *)getPSP();
+            char *name = (char *)psp[0];
+            void **base = (void **)psp[1];
+            uint32_t *size = (uint32_t *)psp[2];
 
+            *base = 0;
+            *size = 0;
+            for (i = 0; i < MAX_SHARED_SEGMENTS; i++)
+            {
+                if (segments[i].base != 0 && compare_string(segments[i].name, name)
+                    && ((tcb[taskCurrent].sharedRead | tcb[taskCurrent].sharedWrite) & (1 << i)))
+                {
+                    *base = segments[i].base;
+                    *size = segments[i].size;
+                }
+            }
             break;
         }
 
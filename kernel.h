@@ -37,8 +37,109 @@ typedef void (*_fn)();
 #define keyReleased 1
 #define flashReq 2
 
+// stream buffer
+#define MAX_STREAM_BUFFERS 1
+#define STREAM_BUFFER_SIZE 128
+#define uartRxStream 0
+
+// software timer
+#define MAX_TIMERS 4
+#define MAX_TIMER_QUEUE_SIZE 4
+#define yellowTimer 0
+#define blueTimer 1
+
 // tasks
+// At most 24: the kernel page below must fit in 1 KB of the 4 KB kernel RAM
+// (task numbers are uint8_t and 0xFF means none, so 255 is the hard ceiling of
+// the scheduler alone); the kernel RAM of each task slot is reported by ps
+// The 4 KB is budgeted for 12 in tm4c123gh6pm.cmd, so more tasks need other cuts
+#ifndef MAX_TASKS
 #define MAX_TASKS 12
+#endif
+#define MAX_BUDGETED_TASKS 4
+
+// memory pools created by the kernel (pool.h); tasks use the others
+#define JITTER_POOL 0
+
+// shared memory segments
+#define MAX_SHARED_SEGMENTS 4
+#define progressSegment 0
+
+// cyclic executive
+#define MAX_CYCLIC_ENTRIES 8
+#define MAX_MINOR_FRAMES 8
+
+// default time slice in ticks
+#define DEFAULT_QUANTUM 1
+
+// priority band assigned deadline-monotonic to periodic tasks
+#define PERIODIC_PRIORITY_HIGHEST 5
+#define PERIODIC_PRIORITY_LOWEST 11
+
+// scheduler policies
+#define SCHED_PRIORITY 0
+#define SCHED_ROUND_ROBIN 1
+#define SCHED_EDF 2
+#define SCHED_STRIDE 3
+
+// default stride scheduling tickets
+#define DEFAULT_TICKETS 100
+
+// criticality levels and kernel modes
+// Tasks are high criticality unless tagged low; low criticality tasks are
+// suspended while the kernel is in high criticality mode
+#define CRITICALITY_LO 0
+#define CRITICALITY_HI 1
+
+// kernel data page, mapped read-only into every task by the MPU
+// KERNEL_PAGE_SIZE is the smallest power of two no smaller than sizeof(kernelPage):
+// a 32 byte header and a 40 byte kernelTaskInfo per task (checked in kernel.c)
+#define KERNEL_PAGE_BYTES (32 + 40 * MAX_TASKS)
+#if KERNEL_PAGE_BYTES <= 256
+#define KERNEL_PAGE_SIZE 256
+#elif KERNEL_PAGE_BYTES <= 512
+#define KERNEL_PAGE_SIZE 512
+#elif KERNEL_PAGE_BYTES <= 1024
+#define KERNEL_PAGE_SIZE 1024
+#else
+#define KERNEL_PAGE_SIZE 0      // Too many tasks for the target, rejected by kernel.c
+#endif
+
+typedef struct _kernelTaskInfo
+{
+    uint32_t pid;                   // address of the task function
+    char name[16];                  // name of the task
+    uint8_t state;                  // see STATE_ values in kernel.c
+    uint8_t currentPriority;        // 0=highest
+    uint8_t blockingResourceType;   // 0=none, 1=mutex, 2=semaphore, 3=stream, 4=timer
+    uint8_t blockingResourceId;     // index of the blocking resource
+    uint32_t runtime;               // cumulative runtime (cycles)
+    uint32_t deadline;              // relative deadline in ticks (0 = none)
+    uint32_t deadlineMisses;        // jobs completed after their deadline
+    uint16_t budget;                // CPU budget in ticks per budget period (0 = unlimited)
+    uint16_t throttles;             // times the budget was exhausted
+} kernelTaskInfo;
+
+typedef struct _kernelPage
+{
+    uint32_t sequence;              // seqlock: odd while the kernel is updating the page
+    uint32_t tickCount;             // 1 ms ticks since startRtos
+    uint8_t taskCount;              // number of valid tasks
+    uint8_t taskCurrent;            // index of the running task
+    uint16_t taskBytes;             // kernel RAM per task slot
+    uint32_t contextSwitches;       // dispatches of a different task since startRtos
+    uint8_t criticalityMode;        // CRITICALITY_LO or CRITICALITY_HI
+    uint8_t heapFragmentation;      // 100 - 100 * largest free run / free bytes
+    uint16_t modeSwitches;          // switches to high criticality mode since startRtos
+    uint16_t heapBytesInUse;        // task heap in use (whole subregions)
+    uint16_t heapLargestFree;       // largest free run of subregions in any region (bytes)
+    uint16_t heapAllocations;       // allocations since startup (wraps)
+    uint16_t heapFailures;          // refused allocations since startup (wraps)
+    uint32_t switchCycles;          // system clock cycles spent in the last context switch
+    kernelTaskInfo tasks[MAX_TASKS];
+} kernelPage;
+
+extern volatile kernelPage kernelData;
 
 //-----------------------------------------------------------------------------
 // Subroutines
@@ -46,6 +147,8 @@ typedef void (*_fn)();
 
 bool initMutex(uint8_t mutex);
 bool initSemaphore(uint8_t semaphore, uint8_t count);
+bool initStreamBuffer(uint8_t stream, uint16_t triggerLevel, uint32_t timeout);
+bool createTimer(uint8_t timer, _fn callback, uint32_t period, bool autoReload, bool start);
 
 void initRtos(void);
 void startRtos(void);
@@ -54,19 +157,47 @@ bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackByt
 void restartThread(_fn fn);
 void stopThread(_fn fn);
 void setThreadPriority(_fn fn, uint8_t priority);
+bool setThreadDeadline(_fn fn, uint32_t deadline);
+bool createPeriodicThread(_fn fn, const char name[], uint32_t period, uint32_t wcet, uint32_t deadline, uint32_t stackBytes);
+void waitNextPeriod(void);
+bool setThreadWcet(_fn fn, uint32_t wcet, uint32_t interval);
+bool setThreadBudget(_fn fn, uint32_t budget, uint32_t period);
+bool setThreadQuantum(_fn fn, uint32_t quantum);
+bool setThreadPreemptThreshold(_fn fn, uint8_t threshold);
+bool setThreadTickets(_fn fn, uint32_t tickets);
+bool setThreadCriticality(_fn fn, uint8_t criticality, uint32_t hiBudget);
+bool grantThreadMemory(_fn fn, void *base, uint32_t size_in_bytes);
+bool createSharedSegment(uint8_t segment, const char name[], uint32_t size_in_bytes);
+bool mapSharedSegment(uint8_t segment, _fn fn, bool writable);
+void openSharedSegment(const char name[], void **base, uint32_t *size_in_bytes);
+bool initCyclicSchedule(uint32_t minorFrame, uint8_t minorFrames);
+bool addCyclicRelease(_fn fn, uint32_t offset);
+void waitNextRelease(void);
 
 void yield(void);
 void sleep(uint32_t tick);
+void sleepUntil(uint32_t *lastWake, uint32_t period);
+void getTickCount(uint32_t *ticks);
+void readKernelPage(kernelPage *copy);
 void lock(int8_t mutex);
 void unlock(int8_t mutex);
 void wait(int8_t semaphore);
 void post(int8_t semaphore);
+void streamReceive(int8_t stream, void *buffer, uint16_t length, uint16_t *count);
+void streamSendFromIsr(uint8_t stream, uint8_t byte);
+void startTimer(int8_t timer);
+void stopTimer(int8_t timer);
+void timerService(void);
 
 void systickIsr(void);
 void pendSvIsr(void);
+void pendSvSwitch(void);
 void svCallIsr(void);
 
 void initTimer(void);
+void initSystemTime(void);
+uint64_t getTimestamp(void);
+uint64_t getTimeUs(void);
 
 void initPeriodicTimer(void);
 
@@ -16,337 +16,41 @@
 //-----------------------------------------------------------------------------
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "tm4c123gh6pm.h"
 #include "mm.h"
+#include "kernel.h"
+#include "Registers.h"
 
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
 
-//-----------------------------------------------------------------------------
-// Constants and Definitions
-//-----------------------------------------------------------------------------
-// Define block sizes and base addresses for memory regions.
-// Each region is divided into subregions of specific sizes for dynamic allocation.
-
-#define BLOCK_SIZE_512     512
-#define BLOCK_SIZE_1024    1024
-#define BLOCK_SIZE_1536    1536
-
-// Base addresses for each memory region
-
-#define REGION_4K0_BASE_ADDR    0x20000000
-#define REGION_4K1_BASE_ADDR    0x20001000
-#define REGION_8K1_BASE_ADDR    0x20002000
-#define REGION_4K2_BASE_ADDR    0x20004000
-#define REGION_4K3_BASE_ADDR    0x20005000
-#define REGION_8K2_BASE_ADDR    0x20006000
-
-#define TOTAL_REGIONS   40          // Total number of subregions available across all memory regions
-
-
-//-----------------------------------------------------------------------------
-// Memory Region Struct and Initialization
-//-----------------------------------------------------------------------------
-// Define a structure for memory regions and initialize them with base addresses and subregion sizes.
-
-typedef struct {
-    uint32_t baseAddress;    // Base address of the region
-    uint32_t subregionSize;  // Size of each subregion (512B or 1024B)
-} MemoryRegion;
-
-// Define the array of regions with correct structure initialization
-MemoryRegion regions[5] = {
-    { 0x20001000, 512  },  // Region 0: 4 KB with 512B subregions
-    { 0x20002000, 1024 },  // Region 1: 8 KB with 1024B subregions
-    { 0x20004000, 512  },  // Region 2: 4 KB with 512B subregions
-    { 0x20005000, 512  },  // Region 3: 4 KB with 512B subregions
-    { 0x20006000, 1024 }   // Region 4: 8 KB with 1024B subregions
-};
-
 uint64_t* srdBitMask = 0x0000000000000000;
 
-typedef struct
-{
-    void *address;                                              // Base of the allocation
-    uint8_t subRegions;                                         // Number of subregions allocated here
-} virtualdata;
-
-//-----------------------------------------------------------------------------
-// Allocation Management
-//-----------------------------------------------------------------------------
-// Structures and arrays to track allocated memory blocks.
-
-uint8_t heapTop = 0;
-uint8_t virtualdata_allotment[TOTAL_REGIONS] = {0, };      // A ledger to keep track allocated subregions, initialised to 0
-virtualdata virtualdata_a[TOTAL_REGIONS] = {{0, 0}, };
+// RBAR (with VALID and the region number) and RASR (SRD bits clear) of the heap
+// MPU regions, read back once setupSramAccess() has programmed them
+uint32_t heapRegionBase[NUM_SRAM_REGIONS];
+uint32_t heapRegionAttr[NUM_SRAM_REGIONS];
 
-#define BLOCK_4K1_START 0
-#define BLOCK_4K1_END   7
-#define BLOCK_8K1_START 8
-#define BLOCK_8K1_END   15
-#define BLOCK_4K2_START 16
-#define BLOCK_4K2_END   23
-#define BLOCK_4K3_START 24
-#define BLOCK_4K3_END   31
-#define BLOCK_8K2_START 32
-#define BLOCK_8K2_END   39
-
-
-
-void *allocation(uint8_t subRegions, uint8_t startRange, uint8_t endRange, uint32_t baseAddr, int16_t offset, uint16_t blockSize)
+// Convert a power-of-two region size in bytes to the MPU SIZE field (2^(SIZE+1) bytes)
+uint8_t mpuSizeField(uint32_t size_in_bytes)
 {
-    uint8_t contiguousSpaces = 0, currentIndex;
-    for (currentIndex = startRange; currentIndex <= endRange; currentIndex++)
-    {
-        if (!(virtualdata_allotment[currentIndex]))
-        {
-            contiguousSpaces++;
-            if (contiguousSpaces >= subRegions)
-            {
-                int8_t i;
-                for ( i = 0; i < subRegions; i++)
-                {
-                    virtualdata_allotment[currentIndex - i] = 1;
-                }
-                virtualdata_a[heapTop].subRegions = subRegions;
-                virtualdata_a[heapTop].address = (void *)(baseAddr + ((currentIndex - subRegions  + offset) * blockSize));
-                return (void *)virtualdata_a[heapTop++].address;
-            }
-
-        }
-        else
-        {
-            contiguousSpaces = 0;
-        }
-
-    }
-    return (void *)0;
-
-}
-    // Allocate memory based on requested size, rounding up to nearest block size.
-    // Attempts allocation in different regions based on block availability.
-    // Returns a pointer to allocated memory or NULL if allocation fails.
-void * mallocFromHeap(uint32_t size_in_bytes)
-{
-    void *ptr;
-
-
-    // Standardize the size based on the requested size
-    if (size_in_bytes <= 512) {
-        size_in_bytes = 512;  // Round up to 512 bytes
-    } else if (size_in_bytes <= 1024) {
-        size_in_bytes = 1024;  // Round up to 1024 bytes
-    } else if (size_in_bytes <= 1536) {
-        size_in_bytes = 1536;  // Set size to 1536 bytes
-    } else
-    {
-        // If size is greater than 1536 bytes, round up to the next multiple of 1024
-        size_in_bytes = ((size_in_bytes + 1023) / 1024) * 1024;
-    }
-
-
-
-    if (size_in_bytes == BLOCK_SIZE_512)
-    {
-        // Allocate a 512-byte block if available
-        if ((size_in_bytes / BLOCK_SIZE_512) > 0)
-        {
-            ptr = allocation(((size_in_bytes / BLOCK_SIZE_512)), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation(((size_in_bytes / BLOCK_SIZE_512)), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation(((size_in_bytes / BLOCK_SIZE_512)), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-           
-        }
-        else
-        {
-            // No 512-byte block available, return NULL or handle error
-        }
-    }
-    else if (size_in_bytes == BLOCK_SIZE_1024)
-    {
-        // Allocate a 1024-byte block if available
-        if ((size_in_bytes / BLOCK_SIZE_512) >= 2) // Check if there are at least 2 consecutive 512B blocks
-        {
-            ptr = allocation((2), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation((2), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation((2), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-            // Code to allocate two consecutive 512-byte blocks
-        }
-        else if ((size_in_bytes / BLOCK_SIZE_1024) > 0)
-        {
-            ptr = allocation(((size_in_bytes / BLOCK_SIZE_1024)), (BLOCK_8K1_START + 1), (BLOCK_8K1_END - 1), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation(((size_in_bytes / BLOCK_SIZE_1024)), (BLOCK_8K2_START + 1), (BLOCK_8K2_END), REGION_8K2_BASE_ADDR, -31, BLOCK_SIZE_1024);
-            if (ptr != 0) return (void *)ptr;
-           
-        }
-
-        else
-        {
-            // No 1024-byte or two consecutive 512-byte blocks available, return NULL or handle error
-        }
-    }
-    else if (size_in_bytes == BLOCK_SIZE_1536)
-    {
-        // Allocate a 1536-byte block if available
-        if(size_in_bytes == BLOCK_SIZE_1536)
-        {
-            ptr = allocation((2), (BLOCK_4K1_END), (BLOCK_8K1_START), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation((2), (BLOCK_8K1_END), (BLOCK_4K2_START), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation((2), (BLOCK_4K3_END), (BLOCK_8K2_START), REGION_4K3_BASE_ADDR, -23, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-            
-        }
-        else if ((size_in_bytes / BLOCK_SIZE_1024) > 0 && (size_in_bytes / BLOCK_SIZE_512) > 0) // Check if there is one 1024B and one 512B block
-        {
-            ptr = allocation((2), (BLOCK_8K1_START + 1), (BLOCK_8K1_END - 1), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation((2), (BLOCK_8K2_START + 1), (BLOCK_8K2_END), REGION_8K2_BASE_ADDR, -31, BLOCK_SIZE_1024);
-            if (ptr != 0) return (void *)ptr;
-           
-        }
-        else if ((size_in_bytes / BLOCK_SIZE_512) >= 3) // Check if there are at least 3 consecutive 512B blocks
-        {
-            ptr = allocation((3), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation((3), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-
-            ptr = allocation((3), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
-            if (ptr != 0) return (void *)ptr;
-         
-        }
-
-    }
-    else if (size_in_bytes >= 1536)
+    uint8_t field = 0;
+    while ((2UL << field) < size_in_bytes)
     {
-       // Allocate multiple 1024-byte blocks for sizes 4096 bytes or larger
-       uint32_t required_blocks = size_in_bytes / BLOCK_SIZE_1024;
-
-       ptr = allocation(required_blocks, BLOCK_8K1_START + 1, BLOCK_8K1_END - 1, REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_1024);
-       if (ptr != 0) return ptr;
-
-       ptr = allocation(required_blocks, BLOCK_8K2_START + 1, BLOCK_8K2_END, REGION_8K2_BASE_ADDR, -31, BLOCK_SIZE_1024);
-       if (ptr != 0) return ptr;
-
-       required_blocks = size_in_bytes / BLOCK_SIZE_512;
-
-       ptr = allocation((required_blocks), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_512);
-       if (ptr != 0) return (void *)ptr;
-
-       ptr = allocation((required_blocks), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_512);
-       if (ptr != 0) return (void *)ptr;
-
-       ptr = allocation((required_blocks), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_512);
-       if (ptr != 0) return (void *)ptr;
-
-
+        field++;
     }
-
-
-
-    return 0;
-}
-
-// Deallocates previously allocated memory and updates the allocation ledger.
-void freeToHeap(void *pMemory)
-{
-    uint8_t i,index;
-       // Identify the allocation entry based on the address (ptr)
-       for ( i = 0; i < heapTop; i++)
-       {
-           if (virtualdata_a[i].address == pMemory)  // Check if the address matches
-           {
-               uint8_t startIndex = 0;
-               uint8_t endIndex = 0;
-               uint32_t address = (uint32_t)pMemory;
-
-               // Calculate the start index based on the region and address
-               if (address >= REGION_4K1_BASE_ADDR && address < REGION_8K1_BASE_ADDR)
-               {
-                   // Region 4K1: Calculate the start index based on 512-byte blocks
-                   startIndex = (address - REGION_4K1_BASE_ADDR) / BLOCK_SIZE_512;
-               }
-               else if (address >= REGION_8K1_BASE_ADDR && address < REGION_4K2_BASE_ADDR)
-               {
-                   // Region 8K1: Calculate the start index based on 1024-byte blocks
-                   startIndex = 8 + (address - REGION_8K1_BASE_ADDR) / BLOCK_SIZE_1024;
-               }
-               else if (address >= REGION_4K2_BASE_ADDR && address < REGION_4K3_BASE_ADDR)
-               {
-                   // Region 4K2: Calculate the start index based on 512-byte blocks
-                   startIndex = 16 + (address - REGION_4K2_BASE_ADDR) / BLOCK_SIZE_512;
-               }
-               else if (address >= REGION_4K3_BASE_ADDR && address < REGION_8K2_BASE_ADDR)
-               {
-                   // Region 4K3: Calculate the start index based on 512-byte blocks
-                   startIndex = 24 + (address - REGION_4K3_BASE_ADDR) / BLOCK_SIZE_512;
-               }
-               else if (address >= REGION_8K2_BASE_ADDR)
-               {
-                   // Region 8K2: Calculate the start index based on 1024-byte blocks
-                   startIndex = 32 + (address - REGION_8K2_BASE_ADDR) / BLOCK_SIZE_1024;
-               }
-
-
-               // Calculate the end index using the number of subregions
-               endIndex = startIndex + virtualdata_a[i].subRegions - 1;
-
-               // Free the allocated regions by marking them as 0 in virtualdata_allotment
-               for ( index = startIndex; index <= endIndex; index++)
-               {
-                   virtualdata_allotment[index] = 0;
-               }
-
-               // Remove the entry from virtualdata_a
-               virtualdata_a[i].address = 0;  // Clear the address
-               virtualdata_a[i].subRegions = 0;  // Clear the subregions count
-
-               //Adjust heapTop if necessary
-               if (i == heapTop - 1)  // If this was the last entry
-               {
-                   heapTop--;
-               }
-
-               return;  // Exit after successfully freeing
-           }
-       }
+    return field;
 }
 
-
 void BackgroundRules(void)
 {
-    NVIC_MPU_NUMBER_R = NVIC_MPU_NUMBER_S;               // Set region number
-
-    NVIC_MPU_BASE_R = 0x00000000;
-
-    NVIC_MPU_ATTR_R |= NVIC_MPU_ATTR_XN;
-    NVIC_MPU_ATTR_R |= 0x03000000;
-    NVIC_MPU_ATTR_R |= 0x00000000;
-    NVIC_MPU_ATTR_R |= NVIC_MPU_ATTR_SHAREABLE;
-    NVIC_MPU_ATTR_R |= NVIC_MPU_ATTR_CACHEABLE;
-    NVIC_MPU_ATTR_R |= NVIC_MPU_ATTR_BUFFRABLE;
-    NVIC_MPU_ATTR_R |= (31 << 1);
-    NVIC_MPU_ATTR_R |= NVIC_MPU_ATTR_ENABLE;
-
+    // Privileged code uses the default memory map wherever no region matches,
+    // so the kernel does not need a full-access background region; unprivileged
+    // accesses outside regions 0-7 fault. This frees a region for the kernel page.
+    NVIC_MPU_CTRL_R |= NVIC_MPU_CTRL_PRIVDEFEN;
 }
 // REQUIRED: include your solution from the mini project
 void allowFlashAccess(void)
@@ -364,26 +68,39 @@ void allowFlashAccess(void)
 
 void allowPeripheralAccess(void)
 {
+    NVIC_MPU_NUMBER_R   = 0x00000000;           // Set peripheral region number
+
+    NVIC_MPU_BASE_R     = 0x40000000;                      // Peripherals and bit-band alias
+
+    NVIC_MPU_ATTR_R     = NVIC_MPU_ATTR_XN;
+    NVIC_MPU_ATTR_R     |= 0x03000000;              // Full memory access
+    NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SHAREABLE;
+    NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_BUFFRABLE;
+    NVIC_MPU_ATTR_R     |= (25 << 1);        // Apply rules to 0x40000000 to 0x43FFFFFF
+    NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_ENABLE;            // Enable region
 }
 
 void setupSramAccess(void)
 {
-    NVIC_MPU_NUMBER_R   = 0x00000002;           // Set Flash region number
+    uint8_t r;
+
+    // Kernel data page: privileged RW, unprivileged RO. The rest of the kernel
+    // SRAM (0x20000000-0x20000FFF) is covered by no region and stays privileged only.
+    NVIC_MPU_NUMBER_R   = 0x00000002;           // Set kernel page region number
 
-    NVIC_MPU_BASE_R     = 0x20000000;                      // Flash address
+    NVIC_MPU_BASE_R     = (uint32_t)&kernelData;           // Aligned to KERNEL_PAGE_SIZE
     NVIC_MPU_ATTR_R     = NVIC_MPU_ATTR_XN;
-    NVIC_MPU_ATTR_R     |= 0x00000000;
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SHAREABLE;
-    NVIC_MPU_ATTR_R     |= (0x01 << 24);              // Full memory access
+    NVIC_MPU_ATTR_R     |= (0x02 << 24);              // Read-only for unprivileged
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_CACHEABLE;         // Cacheable
-    NVIC_MPU_ATTR_R     |= (11 << 1);        // Apply rules to Flash 0x00000 to 0x3FFFF
+    NVIC_MPU_ATTR_R     |= (mpuSizeField(KERNEL_PAGE_SIZE) << 1);
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_ENABLE;            // Enable region
 
     NVIC_MPU_NUMBER_R   = 0x00000003;           // Set Flash region number
 
     NVIC_MPU_BASE_R     = 0x20001000;                      // Flash address
 
-    NVIC_MPU_ATTR_R     |= (0x01 << 24);              // Full memory access
+    NVIC_MPU_ATTR_R     |= (0x03 << 24);              // Full memory access where a task's subregions are enabled
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_CACHEABLE;         // Cacheable
     NVIC_MPU_ATTR_R     |= (11 << 1);        // Apply rules to Flash 0x00000 to 0x3FFFF
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SRD_M;
@@ -399,7 +116,7 @@ void setupSramAccess(void)
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_XN;
     NVIC_MPU_ATTR_R     |= 0x00000000;
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SHAREABLE;
-    NVIC_MPU_ATTR_R     |= (0x01 << 24);              // Full memory access
+    NVIC_MPU_ATTR_R     |= (0x03 << 24);              // Full memory access where a task's subregions are enabled
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_CACHEABLE;         // Cacheable
     NVIC_MPU_ATTR_R     |= (12 << 1);        // Apply rules to Flash 0x00000 to 0x3FFFF
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SRD_M;
@@ -412,7 +129,7 @@ void setupSramAccess(void)
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_XN;
     NVIC_MPU_ATTR_R     |= 0x00000000;
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SHAREABLE;
-    NVIC_MPU_ATTR_R     |= (0x01 << 24);              // Full memory access
+    NVIC_MPU_ATTR_R     |= (0x03 << 24);              // Full memory access where a task's subregions are enabled
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_CACHEABLE;         // Cacheable
     NVIC_MPU_ATTR_R     |= (11 << 1);        // Apply rules to Flash 0x00000 to 0x3FFFF
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SRD_M;
@@ -425,7 +142,7 @@ void setupSramAccess(void)
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_XN;
     NVIC_MPU_ATTR_R     |= 0x00000000;
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SHAREABLE;
-    NVIC_MPU_ATTR_R     |= (0x01 << 24);              // Full memory access
+    NVIC_MPU_ATTR_R     |= (0x03 << 24);              // Full memory access where a task's subregions are enabled
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_CACHEABLE;         // Cacheable
     NVIC_MPU_ATTR_R     |= (11 << 1);        // Apply rules to Flash 0x00000 to 0x3FFFF
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SRD_M;
@@ -438,12 +155,19 @@ void setupSramAccess(void)
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_XN;
     NVIC_MPU_ATTR_R     |= 0x00000000;
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SHAREABLE;
-    NVIC_MPU_ATTR_R     |= (0x01 << 24);              // Full memory access
+    NVIC_MPU_ATTR_R     |= (0x03 << 24);              // Full memory access where a task's subregions are enabled
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_CACHEABLE;         // Cacheable
     NVIC_MPU_ATTR_R     |= (12 << 1);        // Apply rules to Flash 0x00000 to 0x3FFFF
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SRD_M;
     NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_ENABLE;            // Enable region
 
+    // Keep the register values so task images only need their SRD bits filled in
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
+    {
+        NVIC_MPU_NUMBER_R = HEAP_MPU_REGION + r;
+        heapRegionBase[r] = (NVIC_MPU_BASE_R & NVIC_MPU_BASE_ADDR_M) | NVIC_MPU_BASE_VALID | (HEAP_MPU_REGION + r);
+        heapRegionAttr[r] = NVIC_MPU_ATTR_R & ~NVIC_MPU_ATTR_SRD_M;
+    }
 }
 
 uint64_t createNoSramAccessMask(void)
@@ -451,47 +175,89 @@ uint64_t createNoSramAccessMask(void)
     return 0x0000000000000000;
 }
 
+// Returns an access mask with a bit set for every heap subregion that overlaps
+// size_in_bytes at baseAdd; bit n is subregion n % 8 of region n / 8, so a window
+// may span regions with different subregion sizes
+uint64_t sramWindowMask(uint32_t *baseAdd, uint32_t size_in_bytes)
+{
+    uint64_t mask = 0;
+    uint32_t base = (uint32_t)baseAdd, end = base + size_in_bytes, address;
+    uint8_t r, n;
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
+    {
+        for (n = 0; n < SUBREGIONS_PER_REGION; n++)
+        {
+            address = regions[r].baseAddress + n * regions[r].subregionSize;
+            if (address < end && address + regions[r].subregionSize > base)
+                mask |= 1ULL << (r * SUBREGIONS_PER_REGION + n);
+        }
+    }
+    return mask;
+}
+
+// Give a task access to a window of the heap (set bits are accessible subregions)
 void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes)
 {
-    uint8_t i,j;
-        uint32_t regionIndex;
-        for (i = 0; i < 5; i++) {
-                if ((uint32_t)baseAdd >= regions[i].baseAddress && (uint32_t)baseAdd < regions[i].baseAddress + (8 * regions[i].subregionSize)) {
-                    regionIndex = i;
-                    break;
-                }
-            }
-        // Calculate the starting subregion offset for the specified base address in the identified region
-            uint32_t offset = ((uint32_t)baseAdd - regions[regionIndex].baseAddress) / regions[regionIndex].subregionSize;
-
-            // Calculate the number of subregions to enable based on the size
-            uint32_t subregionCount = size_in_bytes / regions[regionIndex].subregionSize;
-
-            for (j = 0; j < subregionCount; j++) {
-                    // Calculate the bit position for the given subregion in the 64-bit srdBitMask
-                    uint64_t bitPosition = regionIndex * 8 + offset + j;
-
-                    // Clear the bit at `bitPosition` to enable access to that subregion
-                    *srdBitMask |= (1 << bitPosition);
-            }
+    *srdBitMask |= sramWindowMask(baseAdd, size_in_bytes);
 }
 
-void applySramAccessMask(uint64_t srdBitMask)
+// Take a window of the heap away from a task
+void removeSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes)
+{
+    *srdBitMask &= ~sramWindowMask(baseAdd, size_in_bytes);
+}
+
+// Returns true if two access masks use any MPU region in common
+bool sramMasksShareRegion(uint64_t a, uint64_t b)
 {
-    uint8_t region;
-    uint8_t subregionMask;
-    for (region = 3; region < 7; region++)
+    uint8_t r;
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
     {
-        // Iterate through each of the 5 SRAM MPU regions
-            NVIC_MPU_NUMBER_R = region;  // Select the current MPU region
+        if (((a >> (r * 8)) & 0xFF) != 0 && ((b >> (r * 8)) & 0xFF) != 0)
+            return true;
+    }
+    return false;
+}
 
-            // Calculate the 8 bits for the current region
-           subregionMask = (srdBitMask >> ((region - 3) * 8)) & 0xFF;
+// Build the RASR values of the heap regions for read-write and read-only access
+// masks (8 bits per region). A subregion the task may use is enabled; the others are
+// disabled, so unprivileged accesses to them match no region and fault. Access is
+// set per region, so a region with read-only subregions is read-only for the task
+// (callers keep the two masks in different regions, see sramMasksShareRegion())
+// Tasks keep the result so a context switch only has to store it
+void buildSramAccessImage(uint64_t srdBitMask, uint64_t readOnlyMask, uint32_t image[NUM_SRAM_REGIONS])
+{
+    uint8_t r, readOnly;
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
+    {
+        readOnly = (readOnlyMask >> (r * 8)) & 0xFF;
+        image[r] = heapRegionAttr[r] | ((uint32_t)(~((srdBitMask >> (r * 8)) | readOnly) & 0xFF) << 8);
+        if (readOnly != 0)
+            image[r] = (image[r] & ~NVIC_MPU_ATTR_AP_M) | (0x02 << 24);    // Unprivileged read-only
+    }
+}
 
-            // Clear existing SRD bits and set new SRD bits for the current region
-            NVIC_MPU_ATTR_R = (NVIC_MPU_ATTR_R & 0xFFFF00FF) | (subregionMask << 8);
+#if defined(MPU_SWITCH_BY_REGION)
+// The context switch path that writeMpuRegions() replaced: select each heap region
+// and read-modify-write its RASR. Build with MPU_SWITCH_BY_REGION defined to time
+// it against the burst store ("Last switch" in ps)
+void writeMpuRegionsByNumber(const uint32_t image[NUM_SRAM_REGIONS])
+{
+    uint8_t r;
+    for (r = 0; r < NUM_SRAM_REGIONS; r++)
+    {
+        NVIC_MPU_NUMBER_R = HEAP_MPU_REGION + r;
+        NVIC_MPU_ATTR_R = (NVIC_MPU_ATTR_R & ~(NVIC_MPU_ATTR_AP_M | NVIC_MPU_ATTR_SRD_M))
+                        | (image[r] & (NVIC_MPU_ATTR_AP_M | NVIC_MPU_ATTR_SRD_M));
     }
+}
+#endif
 
+void applySramAccessMask(uint64_t srdBitMask)
+{
+    uint32_t image[NUM_SRAM_REGIONS];
+    buildSramAccessImage(srdBitMask, 0, image);
+    writeMpuRegions(heapRegionBase, image);
 }
 
 uint64_t setSramAccessWindow(uint32_t *baseAdd, uint32_t size_in_bytes)
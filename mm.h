@@ -12,6 +12,37 @@
 #define MM_H_
 
 #define NUM_SRAM_REGIONS 5
+#define SUBREGIONS_PER_REGION 8
+#define HEAP_MPU_REGION 3       // MPU regions 3-7 cover the heap regions
+
+// Define to replace the best-fit subregion allocator in heap.c with a buddy allocator
+//#define HEAP_BUDDY
+
+// Task heap regions, see heap.c
+typedef struct {
+    uint32_t baseAddress;    // Base address of the region
+    uint32_t subregionSize;  // Size of each subregion (512B or 1024B)
+} MemoryRegion;
+
+#define HEAP_OWNER_KERNEL 0xFF  // allocationOwner of memory that no task owns (pools, shared data)
+
+#define HEAP_BYTES (0x20008000 - 0x20001000)
+#define HEAP_SIZE_CLASSES 5     // failures are counted for requests up to 512, 1K, 2K, 4K and larger
+
+typedef struct _heapStats
+{
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failures[HEAP_SIZE_CLASSES];       // refused requests by size class
+    uint32_t bytesInUse;                        // whole subregions, so includes rounding
+    uint16_t largestFree[NUM_SRAM_REGIONS];     // longest run of free subregions in each region (bytes)
+    uint8_t fragmentation;                      // 100 - 100 * largest free run / free bytes (0 = one run)
+} heapStats;
+
+extern const MemoryRegion regions[NUM_SRAM_REGIONS];
+extern uint8_t freeSubregions[NUM_SRAM_REGIONS];
+extern heapStats heapStatistics;
+extern uint32_t heapRegionBase[NUM_SRAM_REGIONS];
 
 //-----------------------------------------------------------------------------
 // Subroutines
@@ -19,14 +50,28 @@
 
 void * mallocFromHeap(uint32_t size_in_bytes);
 void freeToHeap(void *pMemory);
+void setHeapOwner(void *pMemory, uint8_t owner);
+uint8_t getHeapOwner(void *pMemory);
+void freeHeapOwnedBy(uint8_t owner);
+uint32_t heapOwnedBytes(uint8_t owner, uint8_t *blocks);
+uint32_t heapAllocationBytes(void *pMemory);
+uint32_t heapFreeBytes(void);
 void initFaultInterrupts();
+uint8_t mpuSizeField(uint32_t size_in_bytes);
 void BackgroundRules(void);
 
 void allowFlashAccess(void);
 void allowPeripheralAccess(void);
 void setupSramAccess(void);
 uint64_t createNoSramAccessMask(void);
+uint64_t sramWindowMask(uint32_t *baseAdd, uint32_t size_in_bytes);
 void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes);
+void removeSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes);
 void applySramAccessMask(uint64_t srdBitMask);
+#if defined(MPU_SWITCH_BY_REGION)
+void writeMpuRegionsByNumber(const uint32_t image[NUM_SRAM_REGIONS]);
+#endif
+bool sramMasksShareRegion(uint64_t a, uint64_t b);
+void buildSramAccessImage(uint64_t srdBitMask, uint64_t readOnlyMask, uint32_t image[NUM_SRAM_REGIONS]);
 uint64_t setSramAccessWindow(uint32_t *baseAdd, uint32_t size_in_bytes);
 #endif
@@ -0,0 +1,111 @@
+// Fixed-block memory pools
+// Small objects are carved from one heap allocation instead of taking a whole
+// subregion each; allocation and free are lock-free, so tasks and interrupts can
+// share a pool without a service call or masking interrupts
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mm.h"
+#include "kernel.h"
+#include "pool.h"
+#include "Registers.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+memoryPool *pools[MAX_POOLS];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Create a pool of blockCount blocks of blockSize bytes
+// An owner thread gets the pool mapped into its MPU window and may use it directly;
+// with no owner (0) the pool is for kernel objects and only privileged code can use it
+bool createPool(uint8_t pool, uint16_t blockSize, uint16_t blockCount, _fn owner)
+{
+    bool ok = (pool < MAX_POOLS) && (pools[pool] == 0) && (blockSize > 0) && (blockCount > 0);
+    uint32_t bytes;
+    uint8_t *block;
+    memoryPool *p = 0;
+    uint16_t i;
+
+    blockSize = (blockSize + 3) & ~3;               // Keep every block word aligned
+    bytes = sizeof(memoryPool) + (uint32_t)blockSize * blockCount;
+    if (ok)
+    {
+        p = (memoryPool *)mallocFromHeap(bytes);
+        ok = (p != 0);
+    }
+    if (ok && owner != 0)
+    {
+        ok = grantThreadMemory(owner, p, bytes);
+        if (!ok)
+            freeToHeap(p);
+    }
+    if (ok)
+    {
+        p->blockSize = blockSize;
+        p->blockCount = blockCount;
+        p->used = 0;
+        p->highWater = 0;
+        p->failures = 0;
+        p->owner = (void *)owner;
+        // Chain the blocks in address order
+        block = (uint8_t *)p + sizeof(memoryPool);
+        p->freeList = block;
+        for (i = 0; i < blockCount - 1; i++)
+        {
+            *(void **)block = block + blockSize;
+            block += blockSize;
+        }
+        *(void **)block = 0;
+        pools[pool] = p;
+    }
+    return ok;
+}
+
+// Get the header of a pool owned by the calling task (0 if it does not own it)
+void openPool(uint8_t pool, memoryPool **handle)
+{
+    __asm(" SVC #30");
+}
+
+// Take a block from a pool, returns 0 if the pool is empty
+void *poolAlloc(memoryPool *pool)
+{
+    void *block = atomicPop(&pool->freeList);
+    uint32_t used;
+    if (block != 0)
+    {
+        used = atomicAdd(&pool->used, 1);
+        // Not atomic: a preempting allocation between the test and the store can
+        // leave the mark one allocation low
+        if (used > pool->highWater)
+            pool->highWater = used;
+    }
+    else
+    {
+        atomicAdd(&pool->failures, 1);
+    }
+    return block;
+}
+
+// Return a block to the pool it came from
+void poolFree(memoryPool *pool, void *block)
+{
+    atomicPush(&pool->freeList, block);
+    atomicAdd(&pool->used, -1);
+}
@@ -0,0 +1,47 @@
+// Fixed-block memory pools
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef POOL_H_
+#define POOL_H_
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kernel.h"
+
+#define MAX_POOLS 4
+
+// Pool header, stored at the start of the pool's own heap allocation so the
+// owning task can allocate and free without a service call
+typedef struct _memoryPool
+{
+    void *freeList;                 // first free block; each free block holds the next
+    uint16_t blockSize;             // bytes per block (multiple of 4)
+    uint16_t blockCount;
+    uint32_t used;                  // blocks allocated
+    uint32_t highWater;             // most blocks allocated at once
+    uint32_t failures;              // allocations refused because the pool was empty
+    void *owner;                    // pid of the task that may use the pool (0 = kernel only)
+} memoryPool;
+
+extern memoryPool *pools[MAX_POOLS];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool createPool(uint8_t pool, uint16_t blockSize, uint16_t blockCount, _fn owner);
+void openPool(uint8_t pool, memoryPool **handle);
+void *poolAlloc(memoryPool *pool);
+void poolFree(memoryPool *pool, void *block);
+
+#endif
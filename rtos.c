@@ -20,6 +20,7 @@
 //   Configured to 115,200 baud, 8N1
 // Memory Protection Unit (MPU):
 //   Region to control access to flash, peripherals, and bitbanded areas
+//   Region for the kernel data page (RW for kernel, RO for tasks)
 //   4 or more regions to allow SRAM access (RW or none for task)
 
 //-----------------------------------------------------------------------------
@@ -51,6 +52,7 @@ int main(void)
     initSystemClockTo40Mhz();
     initHw();
     initTimer();
+    initSystemTime();
     initUart0();
     initFaultInterrupts();
 
@@ -75,14 +77,27 @@ int main(void)
     initSemaphore(keyReleased, 0);
     initSemaphore(flashReq, 5);
 
+    // Shell input is read in chunks: wake at 8 bytes or after 20 ms of silence
+    initStreamBuffer(uartRxStream, 8, 20);
+    enableUart0RxInterrupt();
+
+    // Periodic LED toggles run as software timers in the timer service task
+    // (start them from the shell with "timer 0 on" / "timer 1 on")
+    createTimer(yellowTimer, idle4, 125, true, false);
+    createTimer(blueTimer, idle5, 125, true, false);
+
 
     // Add the idle task (mandatory for RTOS) with the lowest priority
         ok =  createThread(idle, "Idle", 15, 512);
 
+    // LengthyFn publishes its progress to Monitor and the shell in a shared segment
+    // Created before the other threads: a thread cannot have read-only and
+    // read-write memory in one heap region, so Monitor's stack must not land next to it
+    ok &= createSharedSegment(progressSegment, "progress", sizeof(lengthyProgress));
+
        
     // Add other processes
     ok &= createThread(lengthyFn, "LengthyFn", 12, 1024);
-    ok &= createThread(flash4Hz, "Flash4Hz", 8, 512);
     ok &= createThread(oneshot, "OneShot", 4, 1536);
     ok &= createThread(readKeys, "ReadKeys", 12, 1024);
     ok &= createThread(debounce, "Debounce", 12, 1024);
@@ -90,6 +105,47 @@ int main(void)
     ok &= createThread(uncooperative, "Uncoop", 12, 1024);
     ok &= createThread(errant, "Errant", 12, 512);
     ok &= createThread(shell, "Shell", 12, 4096);
+    ok &= createThread(timerService, "TimerSvc", 2, 1024);
+    ok &= createThread(monitor, "Monitor", 12, 512);
+
+    // Threads above the periodic band declare their worst-case load so the
+    // periodic admission test can count them (1 ms of work per release)
+    ok &= setThreadWcet(important, 1, 1000);
+    ok &= setThreadWcet(oneshot, 1, 1000);
+    ok &= setThreadWcet(timerService, 2, 125);   // Both LED timers can expire in one period
+
+    ok &= createPeriodicThread(flash4Hz, "Flash4Hz", 125, 1, 125, 512);
+
+    // Uncoop spins without yielding while a button is held, so a longer slice cuts
+    // its switches against the other priority 12 tasks (its 10 ms budget still applies).
+    // LengthyFn yields every millisecond and never uses more than one tick of a slice.
+    ok &= setThreadQuantum(uncooperative, 10);
+
+    // ReadKeys and Debounce hand off through semaphores; neither is preempted by
+    // the other priority 12 tasks while running
+    ok &= setThreadPreemptThreshold(readKeys, 11);
+    ok &= setThreadPreemptThreshold(debounce, 11);
+
+    // Under stride scheduling the shell gets 3 shares of priority 12 for every 1 of the others
+    ok &= setThreadTickets(shell, 300);
+
+    // Contain Uncoop to 10 ms of CPU time every 100 ms, even with preemption off
+    ok &= setThreadBudget(uncooperative, 10, 100);
+
+    // Flash4Hz may overrun its 2 ms budget up to 5 ms; an overrun drops the low
+    // criticality background work until its next period
+    ok &= setThreadBudget(flash4Hz, 2, 125);
+    ok &= setThreadCriticality(flash4Hz, CRITICALITY_HI, 5);
+    ok &= setThreadCriticality(lengthyFn, CRITICALITY_LO, 0);
+    ok &= setThreadCriticality(uncooperative, CRITICALITY_LO, 0);
+
+    // Only LengthyFn and the shell may write the progress segment
+    ok &= mapSharedSegment(progressSegment, lengthyFn, true);
+    ok &= mapSharedSegment(progressSegment, shell, true);
+    ok &= mapSharedSegment(progressSegment, monitor, false);
+
+    // Relative deadlines (ms) used by the EDF policy
+    ok &= setThreadDeadline(timerService, 10);
 
    // Start the RTOS (only if all tasks are successfully created)
     if (ok)
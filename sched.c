@@ -0,0 +1,220 @@
+// Scheduler policy interface
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sched.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+schedTask schedTasks[MAX_TASKS];
+uint32_t schedSequenceCount = 0;
+uint8_t schedPriorityTable[SCHED_NUM_PRIORITIES];
+
+// Indexed by the SCHED_ policy numbers in kernel.h
+const schedPolicy * const schedPolicies[SCHED_POLICY_COUNT] =
+{
+    &schedPriority,
+    &schedRoundRobin,
+    &schedEdf,
+    &schedStride
+};
+const schedPolicy *schedActive = &schedPriority;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Clear the scheduling state of every task and start with the priority policy
+void schedInit(void)
+{
+    uint8_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        schedTasks[i].ready = false;
+        schedTasks[i].next = 0xFF;
+        schedTasks[i].prev = 0xFF;
+    }
+    schedActive = &schedPriority;
+    schedActive->reset();
+}
+
+// Switch to another policy at run time and hand it the ready tasks
+bool schedSetPolicy(uint8_t policy)
+{
+    bool ok = (policy < SCHED_POLICY_COUNT);
+    uint8_t i;
+    if (ok)
+    {
+        schedActive = schedPolicies[policy];
+        schedActive->reset();
+        for (i = 0; i < MAX_TASKS; i++)
+        {
+            schedTasks[i].next = 0xFF;
+            schedTasks[i].prev = 0xFF;
+        }
+        for (i = 0; i < MAX_TASKS; i++)
+        {
+            if (schedTasks[i].ready)
+            {
+                schedActive->onReady(i);
+            }
+        }
+    }
+    return ok;
+}
+
+// Requeue a ready task after its priority or deadline changed
+void schedUpdate(uint8_t task)
+{
+    if (schedTasks[task].ready)
+    {
+        schedActive->onBlock(task);
+        schedActive->onReady(task);
+    }
+}
+
+// Change the priority of a task, moving it between ready queues if needed
+void schedSetPriority(uint8_t task, uint8_t priority)
+{
+    if (schedTasks[task].ready)
+    {
+        schedActive->onBlock(task);
+        schedTasks[task].priority = priority;
+        schedActive->onReady(task);
+    }
+    else
+    {
+        schedTasks[task].priority = priority;
+    }
+}
+
+// Empty a heap
+void schedHeapInit(schedHeap *heap)
+{
+    uint8_t i;
+    heap->size = 0;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        heap->position[i] = 0xFF;
+    }
+}
+
+// Swap two entries of a heap and keep their positions in step
+void schedHeapSwap(schedHeap *heap, uint8_t i, uint8_t j)
+{
+    uint8_t t = heap->task[i];
+    heap->task[i] = heap->task[j];
+    heap->task[j] = t;
+    heap->position[heap->task[i]] = i;
+    heap->position[heap->task[j]] = j;
+}
+
+// Move a task towards the root while it should run before its parent
+void schedHeapUp(schedHeap *heap, uint8_t i)
+{
+    while (i > 0 && heap->before(heap->task[i], heap->task[(i - 1) / 2]))
+    {
+        schedHeapSwap(heap, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+// Move a task towards the leaves while a child should run before it
+void schedHeapDown(schedHeap *heap, uint8_t i)
+{
+    uint8_t smallest;
+    while (true)
+    {
+        smallest = i;
+        if (2 * i + 1 < heap->size && heap->before(heap->task[2 * i + 1], heap->task[smallest]))
+            smallest = 2 * i + 1;
+        if (2 * i + 2 < heap->size && heap->before(heap->task[2 * i + 2], heap->task[smallest]))
+            smallest = 2 * i + 2;
+        if (smallest == i)
+            break;
+        schedHeapSwap(heap, i, smallest);
+        i = smallest;
+    }
+}
+
+// Add a task to a heap, or restore heap order after its key changed
+void schedHeapUpdate(schedHeap *heap, uint8_t task)
+{
+    if (heap->position[task] == 0xFF)
+    {
+        heap->position[task] = heap->size;
+        heap->task[heap->size++] = task;
+    }
+    schedHeapUp(heap, heap->position[task]);
+    schedHeapDown(heap, heap->position[task]);
+}
+
+// Remove a task from a heap
+void schedHeapRemove(schedHeap *heap, uint8_t task)
+{
+    uint8_t i = heap->position[task];
+    if (i == 0xFF)
+        return;
+    heap->size--;
+    if (i != heap->size)
+    {
+        schedHeapSwap(heap, i, heap->size);
+        schedHeapUp(heap, i);
+        schedHeapDown(heap, heap->position[heap->task[i]]);
+    }
+    heap->position[task] = 0xFF;
+}
+
+// Append a task at the tail of a circular ready list (just before *head)
+void schedListInsert(uint8_t *head, uint8_t task)
+{
+    if (schedTasks[task].next != 0xFF)
+        return;
+    if (*head == 0xFF)
+    {
+        schedTasks[task].next = task;
+        schedTasks[task].prev = task;
+        *head = task;
+    }
+    else
+    {
+        uint8_t tail = schedTasks[*head].prev;
+        schedTasks[task].next = *head;
+        schedTasks[task].prev = tail;
+        schedTasks[tail].next = task;
+        schedTasks[*head].prev = task;
+    }
+}
+
+// Unlink a task from a circular ready list
+void schedListRemove(uint8_t *head, uint8_t task)
+{
+    if (schedTasks[task].next == 0xFF)
+        return;
+    if (schedTasks[task].next == task)
+    {
+        *head = 0xFF;
+    }
+    else
+    {
+        schedTasks[schedTasks[task].prev].next = schedTasks[task].next;
+        schedTasks[schedTasks[task].next].prev = schedTasks[task].prev;
+        if (*head == task)
+            *head = schedTasks[task].next;
+    }
+    schedTasks[task].next = 0xFF;
+    schedTasks[task].prev = 0xFF;
+}
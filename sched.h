@@ -0,0 +1,107 @@
+// Scheduler policy interface
+// The scheduler (sched*.c) is hardware independent and is also built on the host
+// by bench/schedsim.c and bench/schedscale.c
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kernel.h"
+
+#define SCHED_NUM_PRIORITIES 256
+#define SCHED_POLICY_COUNT 4
+#define STRIDE_ONE (1UL << 20)
+
+// Count leading zeros, a single CLZ instruction on the M4
+#if defined(__TI_COMPILER_VERSION__)
+#define SCHED_CLZ(x) _norm(x)
+#else
+#define SCHED_CLZ(x) __builtin_clz(x)
+#endif
+
+// Per-task scheduling state, indexed like tcb[]
+// The kernel keeps ready through stride current; sequence, pass, next and prev
+// belong to the policy modules
+typedef struct _schedTask
+{
+    bool ready;                     // task is ready or running
+    bool yielded;                   // gave up the processor voluntarily since it was dispatched
+    uint8_t priority;               // current priority, 0=highest
+    uint8_t preemptThreshold;       // only tasks above this priority preempt it while running
+    uint32_t relativeDeadline;      // deadline after each release in ticks (0 = no deadline)
+    uint32_t absoluteDeadline;      // tick by which the current job must complete
+    uint32_t stride;                // STRIDE_ONE / tickets
+    uint32_t sequence;              // orders ready tasks with equal keys (FIFO)
+    uint32_t pass;                  // stride scheduling virtual time
+    uint8_t next;                   // circular ready list links (0xFF if not listed)
+    uint8_t prev;
+} schedTask;
+
+// A scheduling policy
+// onReady/onBlock are called after the kernel changed the ready flag of a task,
+// pickNext selects the task to run (the running task may keep the processor while
+// inSlice), onTick is called every tick for the running task, reset empties the
+// policy's queues before the ready tasks are handed to it again
+typedef struct _schedPolicy
+{
+    const char *name;
+    void (*reset)(void);
+    void (*onReady)(uint8_t task);
+    void (*onBlock)(uint8_t task);
+    uint8_t (*pickNext)(uint8_t current, bool inSlice);
+    void (*onTick)(uint8_t current);
+} schedPolicy;
+
+// Indexed binary min-heap of task numbers, ordered by a comparison function
+typedef struct _schedHeap
+{
+    uint8_t task[MAX_TASKS];        // heap order, task[0] first
+    uint8_t position[MAX_TASKS];    // index of each task in task[] (0xFF if not queued)
+    uint8_t size;
+    bool (*before)(uint8_t a, uint8_t b);
+} schedHeap;
+
+// One byte per priority for the active policy: "prio" keeps the ready list head of
+// each priority in it, "stride" the level record of each priority
+// A policy only uses it between its reset() and the next switch, so they share it
+extern schedTask schedTasks[MAX_TASKS];
+extern uint32_t schedSequenceCount;
+extern uint8_t schedPriorityTable[SCHED_NUM_PRIORITIES];
+extern const schedPolicy *schedActive;
+extern const schedPolicy * const schedPolicies[SCHED_POLICY_COUNT];
+
+extern const schedPolicy schedPriority;
+extern const schedPolicy schedRoundRobin;
+extern const schedPolicy schedEdf;
+extern const schedPolicy schedStride;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void schedInit(void);
+bool schedSetPolicy(uint8_t policy);
+void schedUpdate(uint8_t task);
+void schedSetPriority(uint8_t task, uint8_t priority);
+
+void schedHeapInit(schedHeap *heap);
+void schedHeapDown(schedHeap *heap, uint8_t i);
+void schedHeapUpdate(schedHeap *heap, uint8_t task);
+void schedHeapRemove(schedHeap *heap, uint8_t task);
+
+void schedListInsert(uint8_t *head, uint8_t task);
+void schedListRemove(uint8_t *head, uint8_t task);
+
+#endif
@@ -0,0 +1,90 @@
+// Earliest-deadline-first scheduling policy
+// Deadline tasks run earliest absolute deadline first, ahead of tasks without a
+// deadline, which fall back to priority order; ties are FIFO
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sched.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Returns true if ready task a should run before ready task b (tick counter wraps)
+static bool edfBefore(uint8_t a, uint8_t b)
+{
+    schedTask *ta = &schedTasks[a];
+    schedTask *tb = &schedTasks[b];
+    if (ta->relativeDeadline && tb->relativeDeadline)
+    {
+        if (ta->absoluteDeadline != tb->absoluteDeadline)
+            return (int32_t)(ta->absoluteDeadline - tb->absoluteDeadline) < 0;
+    }
+    else if (ta->relativeDeadline || tb->relativeDeadline)
+    {
+        return ta->relativeDeadline != 0;
+    }
+    else if (ta->priority != tb->priority)
+    {
+        return ta->priority < tb->priority;
+    }
+    return (int32_t)(ta->sequence - tb->sequence) < 0;
+}
+
+static schedHeap readyHeap = {{0}, {0}, 0, edfBefore};   // ready tasks, min-heap ordered by absolute deadline
+
+static void edfReset(void)
+{
+    schedHeapInit(&readyHeap);
+}
+
+static void edfOnReady(uint8_t task)
+{
+    if (readyHeap.position[task] == 0xFF)
+    {
+        schedTasks[task].sequence = schedSequenceCount++;
+    }
+    schedHeapUpdate(&readyHeap, task);
+}
+
+static void edfOnBlock(uint8_t task)
+{
+    schedHeapRemove(&readyHeap, task);
+}
+
+static uint8_t edfPickNext(uint8_t current, bool inSlice)
+{
+    if (inSlice && !edfBefore(readyHeap.task[0], current))
+    {
+        return current;
+    }
+    // Send the outgoing task behind ready tasks with the same key, so tasks
+    // without a deadline still share the processor round-robin within a priority
+    if (readyHeap.position[current] != 0xFF)
+    {
+        schedTasks[current].sequence = schedSequenceCount++;
+        schedHeapDown(&readyHeap, readyHeap.position[current]);
+    }
+    return readyHeap.size ? readyHeap.task[0] : 0xFF;  // Earliest absolute deadline
+}
+
+static void edfOnTick(uint8_t current)
+{
+    (void)current;                  // Deadlines do not move with time run
+}
+
+const schedPolicy schedEdf =
+{
+    "edf", edfReset, edfOnReady, edfOnBlock, edfPickNext, edfOnTick
+};
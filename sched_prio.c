@@ -0,0 +1,106 @@
+// Fixed priority scheduling policy
+// Highest priority ready task first, round-robin within a priority,
+// with per-task preemption thresholds
+// A two-level bitmap finds the highest ready priority with two CLZ
+// instructions and each priority keeps a circular list of its ready tasks, so
+// every operation takes constant time whatever the number of tasks
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sched.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint32_t readyGroups = 0;                        // bit 31-g set while readyLevels[g] is non-zero
+static uint32_t readyLevels[SCHED_NUM_PRIORITIES / 32]; // bit 31-(p%32) set while priority p has ready tasks
+static uint8_t * const levelHead = schedPriorityTable;  // next task to run at each priority (0xFF if none)
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void prioReset(void)
+{
+    uint16_t p;
+    readyGroups = 0;
+    for (p = 0; p < SCHED_NUM_PRIORITIES / 32; p++)
+    {
+        readyLevels[p] = 0;
+    }
+    for (p = 0; p < SCHED_NUM_PRIORITIES; p++)
+    {
+        levelHead[p] = 0xFF;
+    }
+}
+
+static void prioOnReady(uint8_t task)
+{
+    uint8_t p = schedTasks[task].priority;
+    schedListInsert(&levelHead[p], task);
+    readyLevels[p / 32] |= 0x80000000 >> (p % 32);
+    readyGroups |= 0x80000000 >> (p / 32);
+}
+
+static void prioOnBlock(uint8_t task)
+{
+    uint8_t p = schedTasks[task].priority;
+    schedListRemove(&levelHead[p], task);
+    if (levelHead[p] == 0xFF)
+    {
+        readyLevels[p / 32] &= ~(0x80000000 >> (p % 32));
+        if (readyLevels[p / 32] == 0)
+            readyGroups &= ~(0x80000000 >> (p / 32));
+    }
+}
+
+static uint8_t prioPickNext(uint8_t current, bool inSlice)
+{
+    uint8_t highestPriority;
+    uint8_t group;
+
+    if (readyGroups == 0)
+        return 0xFF;
+    group = SCHED_CLZ(readyGroups);
+    highestPriority = group * 32 + SCHED_CLZ(readyLevels[group]);
+
+    // Let the running task finish its slice if nothing of higher priority is ready
+    // A running task with a preemption threshold keeps the processor until a task
+    // above its threshold is ready, unless it yielded or blocked
+    if ((inSlice && schedTasks[current].priority == highestPriority)
+        || (schedTasks[current].ready && !schedTasks[current].yielded
+            && schedTasks[current].preemptThreshold < schedTasks[current].priority
+            && highestPriority >= schedTasks[current].preemptThreshold))
+    {
+        return current;
+    }
+
+    // Round-robin within the priority: the outgoing task goes to the back
+    if (levelHead[highestPriority] == current)
+    {
+        levelHead[highestPriority] = schedTasks[current].next;
+    }
+    return levelHead[highestPriority];
+}
+
+static void prioOnTick(uint8_t current)
+{
+    (void)current;                  // Strict priority does not age the running task
+}
+
+const schedPolicy schedPriority =
+{
+    "prio", prioReset, prioOnReady, prioOnBlock, prioPickNext, prioOnTick
+};
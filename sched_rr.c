@@ -0,0 +1,66 @@
+// Round-robin scheduling policy
+// Every ready task in turn, regardless of priority, from a circular ready list
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sched.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint8_t rrHead = 0xFF;       // next task to run (0xFF if none ready)
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void rrReset(void)
+{
+    rrHead = 0xFF;
+}
+
+static void rrOnReady(uint8_t task)
+{
+    schedListInsert(&rrHead, task);
+}
+
+static void rrOnBlock(uint8_t task)
+{
+    schedListRemove(&rrHead, task);
+}
+
+static uint8_t rrPickNext(uint8_t current, bool inSlice)
+{
+    if (inSlice)
+    {
+        return current;
+    }
+    // The outgoing task goes to the back of the ready list
+    if (rrHead == current)
+    {
+        rrHead = schedTasks[current].next;
+    }
+    return rrHead;
+}
+
+static void rrOnTick(uint8_t current)
+{
+    (void)current;                  // The kernel counts down time slices
+}
+
+const schedPolicy schedRoundRobin =
+{
+    "rr", rrReset, rrOnReady, rrOnBlock, rrPickNext, rrOnTick
+};
@@ -0,0 +1,142 @@
+// Stride scheduling policy
+// Strict priority levels; within a level, tasks share the processor in
+// proportion to their tickets
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sched.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+// Virtual time of each priority level in use
+// Only priorities some task has need a record, so MAX_TASKS records indexed through
+// a byte map stand in for a 256-entry table of passes
+static uint8_t * const levelOf = schedPriorityTable;    // record of each priority (0xFF = none)
+static uint8_t levelPriority[MAX_TASKS];        // priority of each record
+static uint32_t levelPass[MAX_TASKS];           // pass of the last task dispatched at that priority
+static uint8_t levelCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Returns true if ready task a should run before ready task b
+// Higher priority first; within a priority the lowest pass (wrapping), then FIFO
+static bool strideBefore(uint8_t a, uint8_t b)
+{
+    schedTask *ta = &schedTasks[a];
+    schedTask *tb = &schedTasks[b];
+    if (ta->priority != tb->priority)
+        return ta->priority < tb->priority;
+    if (ta->pass != tb->pass)
+        return (int32_t)(ta->pass - tb->pass) < 0;
+    return (int32_t)(ta->sequence - tb->sequence) < 0;
+}
+
+static schedHeap strideHeap = {{0}, {0}, 0, strideBefore};  // ready tasks, min-heap ordered by priority then pass
+
+// Returns the record of a priority level, claiming one starting at pass if it has none
+// The new priority is held by a task, so at most MAX_TASKS - 1 other priorities are;
+// a full table always has a record whose priority no task holds any more
+static uint8_t strideLevel(uint8_t priority, uint32_t pass)
+{
+    uint8_t level = levelOf[priority];
+    uint8_t i;
+    if (level != 0xFF)
+        return level;
+    if (levelCount < MAX_TASKS)
+    {
+        level = levelCount++;
+    }
+    else
+    {
+        for (level = 0; level < MAX_TASKS; level++)
+        {
+            for (i = 0; i < MAX_TASKS && schedTasks[i].priority != levelPriority[level]; i++);
+            if (i == MAX_TASKS)
+                break;
+        }
+        levelOf[levelPriority[level]] = 0xFF;
+    }
+    levelOf[priority] = level;
+    levelPriority[level] = priority;
+    levelPass[level] = pass;
+    return level;
+}
+
+static void strideReset(void)
+{
+    uint16_t p;
+    schedHeapInit(&strideHeap);
+    for (p = 0; p < SCHED_NUM_PRIORITIES; p++)
+    {
+        levelOf[p] = 0xFF;
+    }
+    levelCount = 0;
+}
+
+static void strideOnReady(uint8_t task)
+{
+    schedTask *t = &schedTasks[task];
+    uint8_t level;
+    if (strideHeap.position[task] == 0xFF)
+    {
+        t->sequence = schedSequenceCount++;
+        // A task rejoining its priority level starts no earlier than the level's
+        // virtual time, so time spent blocked does not build up credit
+        level = strideLevel(t->priority, t->pass);
+        if ((int32_t)(levelPass[level] - t->pass) > 0)
+        {
+            t->pass = levelPass[level];
+        }
+    }
+    schedHeapUpdate(&strideHeap, task);
+}
+
+static void strideOnBlock(uint8_t task)
+{
+    schedHeapRemove(&strideHeap, task);
+}
+
+static uint8_t stridePickNext(uint8_t current, bool inSlice)
+{
+    uint8_t next;
+    if (strideHeap.size == 0)
+        return 0xFF;
+    next = strideHeap.task[0];
+    // The running task keeps its slice unless a higher priority task is ready
+    if (inSlice && schedTasks[next].priority >= schedTasks[current].priority)
+    {
+        return current;
+    }
+    levelPass[strideLevel(schedTasks[next].priority, schedTasks[next].pass)] = schedTasks[next].pass;
+    return next;
+}
+
+// Advance the virtual time of the running task
+static void strideOnTick(uint8_t current)
+{
+    if (strideHeap.position[current] != 0xFF)
+    {
+        schedTasks[current].pass += schedTasks[current].stride;
+        schedHeapDown(&strideHeap, strideHeap.position[current]);
+    }
+}
+
+const schedPolicy schedStride =
+{
+    "stride", strideReset, strideOnReady, strideOnBlock, stridePickNext, strideOnTick
+};
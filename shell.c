@@ -21,6 +21,7 @@
 #include "tasks.h"
 #include "gpio.h"
 #include "wait.h"
+#include "slab.h"
 
 
 
@@ -34,9 +35,7 @@
 #define YELLOW_LED PORTC,4 // off-board yellow LED
 #define GREEN_LED  PORTC,5 // off-board green LED
 
-
-
-PSInfo psInfo;
+#define ALLOC_BENCH_PAIRS 100   // allocate/free pairs timed by the allocbench command
 
 
 
@@ -46,16 +45,65 @@ PSInfo psInfo;
 // Subroutines
 //-----------------------------------------------------------------------------
 
+// Build the process list from the read-only kernel data page (no SVC)
 void ps(PSInfo* info)
 {
-    __asm(" SVC #18");
-
+    kernelPage page;
+    uint32_t totalRuntime = 0;
+    uint8_t i;
+
+    readKernelPage(&page);
+    info->taskCount = page.taskCount;
+    info->contextSwitches = page.contextSwitches;
+    info->taskBytes = page.taskBytes;
+    info->switchCycles = page.switchCycles;
+
+    // Calculate total runtime
+    for (i = 0; i < page.taskCount; i++)
+        totalRuntime += page.tasks[i].runtime;
+
+    // Fill process details
+    for (i = 0; i < page.taskCount; i++)
+    {
+        info->tasks[i].pid = page.tasks[i].pid;
+        manualStringCopy(info->tasks[i].name, page.tasks[i].name, sizeof(info->tasks[i].name));
+        info->tasks[i].state = page.tasks[i].state;
+
+        // Calculate CPU percentage
+        if (totalRuntime > 0)
+            info->tasks[i].cpuPercent = (page.tasks[i].runtime * 100) / totalRuntime;
+        else
+            info->tasks[i].cpuPercent = 0;
+
+        info->tasks[i].blockingResourceType = page.tasks[i].blockingResourceType;
+        info->tasks[i].blockingResourceId = page.tasks[i].blockingResourceId;
+    }
 }
 void ipcs(IPCSInfo* info)
 {
     __asm(" SVC #14");
 
 }
+void frames(FrameInfo* info)
+{
+    __asm(" SVC #29");
+}
+void meminfo(MemInfo* info)
+{
+    __asm(" SVC #32");
+}
+void heapStats(HeapInfo* info)
+{
+    __asm(" SVC #33");
+}
+void poolStats(PoolInfo* info)
+{
+    __asm(" SVC #31");
+}
+void jitter(JitterInfo* info)
+{
+    __asm(" SVC #25");
+}
 void kill(uint32_t pid)
 {
     __asm(" SVC #9");
@@ -79,7 +127,7 @@ void preempt(bool p)
 }
 
 
-void sched(bool p)
+void sched(uint8_t policy)
 {
     __asm(" SVC #7");
 }
@@ -93,6 +141,11 @@ void pidof(char* name)
 {
     __asm(" SVC #10");
 }
+void slice(char* name, uint32_t ticks)
+{
+    __asm(" SVC #27");
+}
+
 void proc(char* name)
 {
     __asm(" SVC #15");
@@ -107,10 +160,17 @@ void Reboot(void)
 void shell(void)
 {
     USER_DATA data;
+    void *base;
+    uint32_t size;
+    volatile lengthyProgress *progress;
+    data.rxCount = 0;                       // No UART chunk buffered yet
+    data.rxIndex = 0;
+    openSharedSegment("progress", &base, &size);
+    progress = (volatile lengthyProgress *)base;
 
 
     while(true){
-        if (kbhitUart0() == 1)
+        // getsUart0 blocks on the UART stream buffer until a full line arrives
         {
             getsUart0(&data);
             parseFields(&data);
@@ -160,12 +220,37 @@ void shell(void)
                         itoa(psInfo.tasks[i].blockingResourceId, buffer);
                         putsUart0(buffer);
                     }
+                    else if (psInfo.tasks[i].blockingResourceType == 3)
+                    {
+                        putsUart0("Stream ");
+                        itoa(psInfo.tasks[i].blockingResourceId, buffer);
+                        putsUart0(buffer);
+                    }
+                    else if (psInfo.tasks[i].blockingResourceType == 4)
+                    {
+                        putsUart0("Timer");
+                    }
                     else
                     {
                         putsUart0("None");
                     }
                     putsUart0("\r\n");
                 }
+                {
+                    char buffer[12];
+                    putsUart0("Context switches: ");
+                    itoa(psInfo.contextSwitches, buffer);
+                    putsUart0(buffer);
+                    putsUart0("\r\n");
+                    putsUart0("Last switch: ");
+                    itoa(psInfo.switchCycles, buffer);
+                    putsUart0(buffer);
+                    putsUart0(" cycles\r\n");
+                    putsUart0("Kernel RAM per task: ");
+                    itoa(psInfo.taskBytes, buffer);
+                    putsUart0(buffer);
+                    putsUart0(" bytes\r\n");
+                }
 
             }
             if(isCommand(&data,"ipcs",0))
@@ -230,6 +315,43 @@ void shell(void)
                     }
                     putsUart0("]\r\n");
                 }
+
+                // Display Stream Buffer Information
+                putsUart0("Streams:\r\n");
+                for (i = 0; i < SHELL_MAX_STREAM_BUFFERS; i++)
+                {
+                    putsUart0("Stream ");
+                    itoa(i, numStr);
+                    putsUart0(numStr);
+                    putsUart0(": Count=");
+                    itoa(ipcsInfo.streams[i].count, numStr);
+                    putsUart0(numStr);
+                    putsUart0(", Trigger=");
+                    itoa(ipcsInfo.streams[i].triggerLevel, numStr);
+                    putsUart0(numStr);
+                    putsUart0(", Reader=");
+                    itoa(ipcsInfo.streams[i].reader, numStr);
+                    putsUart0(numStr);
+                    putsUart0("\r\nBytes=");
+                    itoa(ipcsInfo.streams[i].bytesReceived, numStr);
+                    putsUart0(numStr);
+                    putsUart0(", Wakeups=");
+                    itoa(ipcsInfo.streams[i].wakeups, numStr);
+                    putsUart0(numStr);
+                    putsUart0(", Wakeups/KB=");
+                    if (ipcsInfo.streams[i].bytesReceived > 0)
+                        itoa((ipcsInfo.streams[i].wakeups * 1024) / ipcsInfo.streams[i].bytesReceived, numStr);
+                    else
+                        itoa(0, numStr);
+                    putsUart0(numStr);
+                    putsUart0(", Empty timeouts=");
+                    itoa(ipcsInfo.streams[i].emptyTimeouts, numStr);
+                    putsUart0(numStr);
+                    putsUart0(", Overruns=");
+                    itoa(ipcsInfo.streams[i].overruns, numStr);
+                    putsUart0(numStr);
+                    putsUart0("\r\n");
+                }
             }
             if(isCommand(&data,"kill",1))
             {
@@ -246,6 +368,14 @@ void shell(void)
 
             }
 
+            if(isCommand(&data,"slice",2))
+            {
+                char* proc_name = getFieldString(&data, 1);
+                uint32_t ticks = getFieldInteger(&data, 2);
+                slice(proc_name, ticks);
+
+            }
+
             if(isCommand(&data,"preempt",1))
             {
                 char* status = getFieldString(&data, 1);
@@ -267,12 +397,328 @@ void shell(void)
                 if (compare_string(status, "prio"))
                 {
 
-                    sched(true);
+                    sched(SCHED_PRIORITY);
 
                 }
                 if(compare_string(status, "rr"))
                 {
-                    sched(false);
+                    sched(SCHED_ROUND_ROBIN);
+                }
+                if(compare_string(status, "edf"))
+                {
+                    sched(SCHED_EDF);
+                }
+                if(compare_string(status, "stride"))
+                {
+                    sched(SCHED_STRIDE);
+                }
+
+            }
+            if(isCommand(&data,"uptime",0))
+            {
+                char buffer[12];
+                uint64_t us = getTimeUs();      // read directly from the system clock, no SVC
+
+                itoa(us / 1000000, buffer);
+                putsUart0(buffer);
+                putsUart0(".");
+                itoa(us % 1000000 + 1000000, buffer);   // keep the leading zeros
+                putsUart0(&buffer[1]);
+                putsUart0(" s\r\n");
+            }
+            if(isCommand(&data,"jitter",0))
+            {
+                uint8_t i;
+                JitterInfo jitterInfo;
+                char buffer[12];
+                jitter(&jitterInfo);
+
+                // Display release jitter for tasks that sleep
+                putsUart0("Name            Releases    Min(us)    Avg(us)    Max(us)\r\n");
+                for (i = 0; i < jitterInfo.taskCount; i++)
+                {
+                    if (jitterInfo.tasks[i].releases == 0)
+                        continue;
+                    putsUart0(jitterInfo.tasks[i].name);
+                    putsUart0("    ");
+                    itoa(jitterInfo.tasks[i].releases, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(jitterInfo.tasks[i].minJitter, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(jitterInfo.tasks[i].avgJitter, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(jitterInfo.tasks[i].maxJitter, buffer);
+                    putsUart0(buffer);
+                    putsUart0("\r\n");
+                }
+            }
+            if(isCommand(&data,"deadlines",0))
+            {
+                uint8_t i;
+                kernelPage page;
+                char buffer[12];
+                readKernelPage(&page);      // read directly from the kernel data page, no SVC
+
+                // Display deadline misses for tasks with an EDF deadline
+                putsUart0("Name            Deadline(ms)    Misses\r\n");
+                for (i = 0; i < page.taskCount; i++)
+                {
+                    if (page.tasks[i].deadline == 0)
+                        continue;
+                    putsUart0(page.tasks[i].name);
+                    putsUart0("    ");
+                    itoa(page.tasks[i].deadline, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(page.tasks[i].deadlineMisses, buffer);
+                    putsUart0(buffer);
+                    putsUart0("\r\n");
+                }
+            }
+            if(isCommand(&data,"meminfo",0))
+            {
+                uint8_t i;
+                MemInfo memInfo;
+                char buffer[12];
+                meminfo(&memInfo);
+
+                // Display the heap owned by each task
+                putsUart0("Name            Stack    Blocks    Bytes\r\n");
+                for (i = 0; i < memInfo.taskCount; i++)
+                {
+                    putsUart0(memInfo.tasks[i].name);
+                    putsUart0("    ");
+                    itoa(memInfo.tasks[i].stackBytes, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(memInfo.tasks[i].blocks, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(memInfo.tasks[i].bytes, buffer);
+                    putsUart0(buffer);
+                    putsUart0("\r\n");
+                }
+                putsUart0("Kernel: ");
+                itoa(memInfo.kernelBytes, buffer);
+                putsUart0(buffer);
+                putsUart0(" bytes, free: ");
+                itoa(memInfo.freeBytes, buffer);
+                putsUart0(buffer);
+                putsUart0(" bytes\r\n");
+            }
+            if(isCommand(&data,"heap",0))
+            {
+                uint8_t i;
+                HeapInfo heapInfo;
+                char buffer[12];
+                static const char * const classNames[SHELL_HEAP_SIZE_CLASSES] = {"512", "1K", "2K", "4K", ">4K"};
+                heapStats(&heapInfo);
+
+                // Display the heap counters and fragmentation
+                putsUart0("Allocations: ");
+                itoa(heapInfo.allocations, buffer);
+                putsUart0(buffer);
+                putsUart0("  Frees: ");
+                itoa(heapInfo.frees, buffer);
+                putsUart0(buffer);
+                putsUart0("  In use: ");
+                itoa(heapInfo.bytesInUse, buffer);
+                putsUart0(buffer);
+                putsUart0(" bytes\r\nFailures by size:");
+                for (i = 0; i < SHELL_HEAP_SIZE_CLASSES; i++)
+                {
+                    putsUart0("  ");
+                    putsUart0((char *)classNames[i]);
+                    putsUart0(": ");
+                    itoa(heapInfo.failures[i], buffer);
+                    putsUart0(buffer);
+                }
+                putsUart0("\r\nLargest free run by region:");
+                for (i = 0; i < SHELL_NUM_SRAM_REGIONS; i++)
+                {
+                    putsUart0("  ");
+                    itoa(heapInfo.largestFree[i], buffer);
+                    putsUart0(buffer);
+                }
+                putsUart0("\r\nFragmentation: ");
+                itoa(heapInfo.fragmentation, buffer);
+                putsUart0(buffer);
+                putsUart0("%\r\n");
+            }
+            if(isCommand(&data,"pools",0))
+            {
+                uint8_t i;
+                PoolInfo poolInfo;
+                char buffer[12];
+                poolStats(&poolInfo);
+
+                // Display the fixed-block pools and their high-water marks
+                putsUart0("Pool  Block  Count  Used  Peak  Failed  Owner\r\n");
+                for (i = 0; i < SHELL_MAX_POOLS; i++)
+                {
+                    if (poolInfo.pools[i].blockSize == 0)
+                        continue;
+                    itoa(i, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(poolInfo.pools[i].blockSize, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(poolInfo.pools[i].blockCount, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(poolInfo.pools[i].used, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(poolInfo.pools[i].highWater, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(poolInfo.pools[i].failures, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    putsUart0(poolInfo.pools[i].owner[0] ? poolInfo.pools[i].owner : "kernel");
+                    putsUart0("\r\n");
+                }
+            }
+            if(isCommand(&data,"allocbench",0))
+            {
+                uint32_t arena[128];            // 512 bytes of the shell stack, already accessible
+                slabHeap *heap = slabInit(arena, sizeof(arena));
+                void *block = 0;
+                uint64_t start;
+                uint32_t slabCycles, svcCycles;
+                uint16_t i;
+                char buffer[12];
+
+                // Time a 32 byte allocate + free from the task-local heap ...
+                start = getTimestamp();
+                for (i = 0; i < ALLOC_BENCH_PAIRS; i++)
+                {
+                    block = slabAlloc(heap, 32);
+                    slabFree(heap, block);
+                }
+                slabCycles = (getTimestamp() - start) / ALLOC_BENCH_PAIRS;
+
+                // ... and through the kernel heap (SVC 16 and 17)
+                start = getTimestamp();
+                for (i = 0; i < ALLOC_BENCH_PAIRS; i++)
+                {
+                    SVCmallocFromHeap(32, &block);
+                    SVCfreeToHeap(block);
+                }
+                svcCycles = (getTimestamp() - start) / ALLOC_BENCH_PAIRS;
+
+                putsUart0("Cycles per 32 byte alloc + free\r\n");
+                putsUart0("Task heap:    ");
+                itoa(slabCycles, buffer);
+                putsUart0(buffer);
+                putsUart0("\r\nSVC 16/17:    ");
+                itoa(svcCycles, buffer);
+                putsUart0(buffer);
+                putsUart0("\r\n");
+            }
+            if(isCommand(&data,"frames",0))
+            {
+                uint8_t i;
+                FrameInfo frameInfo;
+                char buffer[12];
+                frames(&frameInfo);
+
+                // Display the cyclic executive configuration and overruns per minor frame
+                if (frameInfo.minorFrame == 0)
+                {
+                    putsUart0("Cyclic executive off\r\n");
+                }
+                else
+                {
+                    putsUart0("Minor frame(ms): ");
+                    itoa(frameInfo.minorFrame, buffer);
+                    putsUart0(buffer);
+                    putsUart0("  Releases: ");
+                    itoa(frameInfo.entries, buffer);
+                    putsUart0(buffer);
+                    putsUart0("  Major frames: ");
+                    itoa(frameInfo.majorFrames, buffer);
+                    putsUart0(buffer);
+                    putsUart0("\r\nFrame    Overruns\r\n");
+                    for (i = 0; i < frameInfo.minorFrames; i++)
+                    {
+                        itoa(i, buffer);
+                        putsUart0(buffer);
+                        putsUart0("    ");
+                        itoa(frameInfo.overruns[i], buffer);
+                        putsUart0(buffer);
+                        putsUart0("\r\n");
+                    }
+                }
+            }
+            if(isCommand(&data,"budgets",0))
+            {
+                uint8_t i;
+                kernelPage page;
+                char buffer[12];
+                readKernelPage(&page);      // read directly from the kernel data page, no SVC
+
+                // Display the criticality mode, CPU budgets and how often they were exhausted
+                putsUart0("Mode: ");
+                putsUart0(page.criticalityMode == CRITICALITY_HI ? "HI" : "LO");
+                putsUart0("    Mode switches: ");
+                itoa(page.modeSwitches, buffer);
+                putsUart0(buffer);
+                putsUart0("\r\n");
+                putsUart0("Name            Budget(ms)    Throttled\r\n");
+                for (i = 0; i < page.taskCount; i++)
+                {
+                    if (page.tasks[i].budget == 0)
+                        continue;
+                    putsUart0(page.tasks[i].name);
+                    putsUart0("    ");
+                    itoa(page.tasks[i].budget, buffer);
+                    putsUart0(buffer);
+                    putsUart0("    ");
+                    itoa(page.tasks[i].throttles, buffer);
+                    putsUart0(buffer);
+                    putsUart0("\r\n");
+                }
+            }
+            if(isCommand(&data,"progress",0))
+            {
+                char buffer[12];
+
+                // Read LengthyFn's progress straight from the shared segment
+                if (progress == 0)
+                {
+                    putsUart0("Progress segment not mapped\r\n");
+                }
+                else
+                {
+                    putsUart0("LengthyFn passes: ");
+                    itoa(progress->passes, buffer);
+                    putsUart0(buffer);
+                    putsUart0("  Index: ");
+                    itoa(progress->index, buffer);
+                    putsUart0(buffer);
+                    putsUart0("\r\n");
+                    // "progress write": Monitor's next look at the segment stores to
+                    // its read-only mapping and takes an MPU fault
+                    if (data.fieldCount > 1 && compare_string(getFieldString(&data, 1), "write"))
+                        progress->writeRequest = 1;
+                }
+            }
+            if(isCommand(&data,"timer",2))
+            {
+                uint8_t timer = getFieldInteger(&data, 1);
+                char* status = getFieldString(&data, 2);
+                if (compare_string(status, "on"))
+                {
+                    startTimer(timer);
+                }
+                if (compare_string(status, "off"))
+                {
+                    stopTimer(timer);
                 }
 
             }
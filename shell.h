@@ -15,7 +15,13 @@
 #define SHELL_MAX_SEMAPHORE_QUEUE_SIZE 2
 #define SHELL_MAX_MUTEXES 1
 #define SHELL_MAX_SEMAPHORES 3
+#define SHELL_MAX_STREAM_BUFFERS 1
+#ifdef MAX_TASKS                       // Overridden on the command line for the whole build
+#define SHELL_MAX_TASKS MAX_TASKS
+#else
 #define SHELL_MAX_TASKS 12
+#endif
+#define SHELL_MAX_MINOR_FRAMES 8
 
 // task states
 #define SHELL_STATE_INVALID           0 // no task
@@ -24,6 +30,11 @@
 #define SHELL_STATE_DELAYED           3 // has run, but now awaiting timer
 #define SHELL_STATE_BLOCKED_MUTEX     4 // has run, but now blocked by semaphore
 #define SHELL_STATE_BLOCKED_SEMAPHORE 5 // has run, but now blocked by semaphore
+#define SHELL_STATE_BLOCKED_STREAM    6 // has run, but now waiting for stream data
+#define SHELL_STATE_BLOCKED_TIMER     7 // has run, but now waiting for a timer to expire
+#define SHELL_STATE_THROTTLED         8 // has run, but exhausted its budget until replenishment
+#define SHELL_STATE_BLOCKED_RELEASE   9 // has run, but now waiting for its cyclic release
+#define SHELL_STATE_SUSPENDED        10 // low criticality, held in high criticality mode
 
 typedef struct
 {
@@ -31,7 +42,7 @@ typedef struct
     char name[16];                // Process name
     uint8_t state;                // Process state
     uint32_t cpuPercent;          // CPU usage percentage
-    uint8_t blockingResourceType; // 0=none, 1=mutex, 2=semaphore
+    uint8_t blockingResourceType; // 0=none, 1=mutex, 2=semaphore, 3=stream, 4=timer
     uint8_t blockingResourceId;   // Index of the blocking mutex/semaphore
 } ProcessStatus;
 
@@ -39,8 +50,26 @@ typedef struct
 {
     ProcessStatus tasks[SHELL_MAX_TASKS];
     uint8_t taskCount;
+    uint32_t contextSwitches;     // Dispatches of a different task since startup
+    uint16_t taskBytes;           // Kernel RAM per task slot
+    uint32_t switchCycles;        // Cycles spent in the last context switch
 } PSInfo;
 
+typedef struct
+{
+    char name[16];                // Process name
+    uint32_t releases;            // Number of releases from a delay
+    uint32_t minJitter;           // Shortest release-to-dispatch latency (us)
+    uint32_t maxJitter;           // Longest release-to-dispatch latency (us)
+    uint32_t avgJitter;           // Average release-to-dispatch latency (us)
+} JitterStatus;
+
+typedef struct
+{
+    JitterStatus tasks[SHELL_MAX_TASKS];
+    uint8_t taskCount;
+} JitterInfo;
+
 typedef struct
 {
     bool lock;
@@ -56,12 +85,80 @@ typedef struct
     uint8_t processQueue[SHELL_MAX_SEMAPHORE_QUEUE_SIZE];
 } SemaphoreInfo;
 
+typedef struct
+{
+    uint16_t count;               // Bytes waiting in the buffer
+    uint16_t triggerLevel;        // Bytes needed to wake the reader
+    uint8_t reader;               // Blocked reader (0xFF if none)
+    uint32_t bytesReceived;       // Total bytes handed to readers
+    uint32_t wakeups;             // Number of reader wakeups that delivered data
+    uint32_t emptyTimeouts;       // Reader timeouts with no data
+    uint32_t overruns;            // Bytes dropped on a full buffer
+} StreamInfo;
+
 typedef struct
 {
     MutexInfo mutexes[SHELL_MAX_MUTEXES];
     SemaphoreInfo semaphores[SHELL_MAX_SEMAPHORES];
+    StreamInfo streams[SHELL_MAX_STREAM_BUFFERS];
 } IPCSInfo;
 
+typedef struct
+{
+    uint32_t minorFrame;          // Minor frame length in ticks (0 = cyclic executive off)
+    uint8_t minorFrames;          // Minor frames per major frame
+    uint8_t entries;              // Releases in the schedule table
+    uint32_t majorFrames;         // Major frames completed
+    uint32_t overruns[SHELL_MAX_MINOR_FRAMES]; // Frames ended with a released task still running
+} FrameInfo;
+
+typedef struct
+{
+    char name[16];                // Process name
+    uint8_t state;                // Process state (stopped tasks own no memory)
+    uint8_t blocks;               // Heap allocations owned, including the stack
+    uint16_t stackBytes;          // Requested stack size
+    uint32_t bytes;               // Heap bytes owned (whole subregions)
+} MemoryStatus;
+
+typedef struct
+{
+    MemoryStatus tasks[SHELL_MAX_TASKS];
+    uint8_t taskCount;
+    uint32_t kernelBytes;         // Heap owned by no task (pools)
+    uint32_t freeBytes;
+} MemInfo;
+
+#define SHELL_HEAP_SIZE_CLASSES 5
+#define SHELL_NUM_SRAM_REGIONS 5
+
+typedef struct
+{
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failures[SHELL_HEAP_SIZE_CLASSES];   // Refused requests up to 512, 1K, 2K, 4K and larger
+    uint32_t bytesInUse;                          // Whole subregions, so includes rounding
+    uint16_t largestFree[SHELL_NUM_SRAM_REGIONS]; // Longest free run in each region (bytes)
+    uint8_t fragmentation;                        // 100 - 100 * largest free run / free bytes
+} HeapInfo;
+
+#define SHELL_MAX_POOLS 4
+
+typedef struct
+{
+    uint16_t blockSize;           // Bytes per block (0 = pool not created)
+    uint16_t blockCount;
+    uint32_t used;                // Blocks allocated
+    uint32_t highWater;           // Most blocks allocated at once
+    uint32_t failures;            // Allocations refused because the pool was empty
+    char owner[16];               // Owning task, empty for kernel pools
+} PoolStatus;
+
+typedef struct
+{
+    PoolStatus pools[SHELL_MAX_POOLS];
+} PoolInfo;
+
 
 
 
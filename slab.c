@@ -0,0 +1,107 @@
+// Task-local small-object heap
+// Hands out 8 to 128 byte blocks from memory the task can already access (its
+// stack or a block from SVC 16), so small allocations need no service call and
+// no MPU change; one heap belongs to one task and is not shared
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "slab.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Returns the size class of a request (size_in_bytes must not exceed SLAB_MAX_BLOCK)
+static uint8_t slabClass(uint32_t size_in_bytes)
+{
+    uint8_t c = 0;
+    while ((SLAB_MIN_BLOCK << c) < size_in_bytes)
+        c++;
+    return c;
+}
+
+// Build a heap in size_in_bytes of memory, returns 0 if there is no room for a page
+// The memory is split into fixed pages that are given to size classes on demand
+slabHeap *slabInit(void *memory, uint32_t size_in_bytes)
+{
+    slabHeap *heap = (slabHeap *)memory;
+    uint32_t start = ((uint32_t)memory + sizeof(slabHeap) + 7) & ~7;
+    uint32_t pages;
+    uint8_t c;
+
+    if (start + SLAB_PAGE_SIZE > (uint32_t)memory + size_in_bytes)
+        return 0;
+    pages = ((uint32_t)memory + size_in_bytes - start) / SLAB_PAGE_SIZE;
+    heap->pages = (uint8_t *)start;
+    heap->pageCount = (pages > SLAB_MAX_PAGES) ? SLAB_MAX_PAGES : pages;
+    heap->nextPage = 0;
+    for (c = 0; c < SLAB_CLASSES; c++)
+    {
+        heap->freeList[c] = 0;
+    }
+    heap->used = 0;
+    heap->failures = 0;
+    return heap;
+}
+
+// Allocate a block of at least size_in_bytes, returns 0 if the heap is full
+// Takes the head of the size class list, carving a new page into it when empty
+void *slabAlloc(slabHeap *heap, uint32_t size_in_bytes)
+{
+    uint8_t c, *page;
+    uint16_t size, i;
+    void *block;
+
+    if (size_in_bytes == 0 || size_in_bytes > SLAB_MAX_BLOCK)
+    {
+        heap->failures++;
+        return 0;
+    }
+    c = slabClass(size_in_bytes);
+    if (heap->freeList[c] == 0)
+    {
+        if (heap->nextPage == heap->pageCount)
+        {
+            heap->failures++;
+            return 0;
+        }
+        size = SLAB_MIN_BLOCK << c;
+        page = heap->pages + heap->nextPage * SLAB_PAGE_SIZE;
+        heap->pageClass[heap->nextPage++] = c;
+        for (i = 0; i + size < SLAB_PAGE_SIZE; i += size)
+        {
+            *(void **)(page + i) = page + i + size;
+        }
+        *(void **)(page + i) = 0;
+        heap->freeList[c] = page;
+    }
+    block = heap->freeList[c];
+    heap->freeList[c] = *(void **)block;
+    heap->used++;
+    return block;
+}
+
+// Return a block to the heap; its page gives the size class, so the size is not needed
+// Pointers outside the pages are ignored
+void slabFree(slabHeap *heap, void *block)
+{
+    uint32_t page = ((uint8_t *)block - heap->pages) / SLAB_PAGE_SIZE;
+    uint8_t c;
+    if ((uint8_t *)block < heap->pages || page >= heap->nextPage)
+        return;
+    c = heap->pageClass[page];
+    *(void **)block = heap->freeList[c];
+    heap->freeList[c] = block;
+    heap->used--;
+}
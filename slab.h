@@ -0,0 +1,47 @@
+// Task-local small-object heap
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef SLAB_H_
+#define SLAB_H_
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SLAB_PAGE_SIZE  128         // bytes per page; every page holds blocks of one size class
+#define SLAB_MAX_PAGES  32          // up to 4 KB of pages per heap
+#define SLAB_MIN_BLOCK  8           // smallest size class
+#define SLAB_CLASSES    5           // 8, 16, 32, 64 and 128 byte blocks
+#define SLAB_MAX_BLOCK  (SLAB_MIN_BLOCK << (SLAB_CLASSES - 1))
+
+// Heap header, stored at the start of the memory it manages so a task can keep
+// it in its own stack or heap block
+typedef struct _slabHeap
+{
+    uint8_t *pages;                         // first page, 8 byte aligned
+    uint8_t pageCount;
+    uint8_t nextPage;                       // pages below this have been given to a size class
+    uint8_t pageClass[SLAB_MAX_PAGES];      // size class of each page
+    void *freeList[SLAB_CLASSES];           // free blocks of each size class; each holds the next
+    uint32_t used;                          // blocks allocated
+    uint32_t failures;                      // allocations refused
+} slabHeap;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+slabHeap *slabInit(void *memory, uint32_t size_in_bytes);
+void *slabAlloc(slabHeap *heap, uint32_t size_in_bytes);
+void slabFree(slabHeap *heap, void *block);
+
+#endif
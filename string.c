@@ -36,6 +36,10 @@ void manualStringCopy(char* dest, const char* src, uint8_t maxLength)
     dest[i] = '\0'; // Null-terminate the destination string
 }
 
+// Reads a line from the UART RX stream buffer
+// Characters arrive in chunks (trigger level or timeout), so the task wakes once
+// per chunk instead of once per byte; bytes following the enter key are kept in
+// data->rxChunk for the next call
 void getsUart0(USER_DATA *data)
 {
     uint8_t count = 0;
@@ -43,9 +47,9 @@ void getsUart0(USER_DATA *data)
 
     while (true)
     {
-        if(kbhitUart0())
+        if (data->rxIndex < data->rxCount)
         {
-            c = getcUart0();
+            c = data->rxChunk[data->rxIndex++];
 
             if (c == 8 || c == 127) //8 or 127 for backspace
             {
@@ -75,7 +79,8 @@ void getsUart0(USER_DATA *data)
         }
         else
         {
-            yield();
+            data->rxIndex = 0;
+            streamReceive(uartRxStream, data->rxChunk, MAX_RX_CHUNK, &data->rxCount);
         }
     }
 }
@@ -13,6 +13,7 @@
 #include <inttypes.h>
 #define MAX_CHARS 80
 #define MAX_FIELDS 5
+#define MAX_RX_CHUNK 16
 
 typedef struct USER_DATA
 {
@@ -20,6 +21,9 @@ char buffer[MAX_CHARS+1];
 uint8_t fieldCount;
 uint8_t fieldPosition[MAX_FIELDS];
 char fieldType[MAX_FIELDS];
+char rxChunk[MAX_RX_CHUNK];     // last chunk read from the UART stream buffer
+uint16_t rxCount;               // bytes held in rxChunk
+uint16_t rxIndex;               // next byte of rxChunk to process
 } USER_DATA;
 
 char* hexToString(uint32_t hex);
@@ -134,22 +134,14 @@ void idle3(void)
         yield();
     }
 }
+// software timer callbacks, run by the timer service task every 125 ms
 void idle4(void)
 {
-
-    while(true)
-    {
-        setPinValue(YELLOW_LED, !getPinValue(YELLOW_LED));
-        sleep(125);
-    }
+    setPinValue(YELLOW_LED, !getPinValue(YELLOW_LED));
 }
 void idle5(void)
 {
-    while(true)
-    {
-        setPinValue(BLUE_LED, !getPinValue(BLUE_LED));
-        sleep(125);
-    }
+    setPinValue(BLUE_LED, !getPinValue(BLUE_LED));
 }
 
 
@@ -158,7 +150,7 @@ void flash4Hz(void)
     while(true)
     {
         setPinValue(GREEN_LED, !getPinValue(GREEN_LED));
-        sleep(125);
+        waitNextPeriod();
     }
 }
 
@@ -193,17 +185,34 @@ void lengthyFn(void)
     uint16_t i;
     uint8_t *mem;
     void *ptr1 = 0;
-    SVCmallocFromHeap(5000 * sizeof(uint8_t), (void *)&ptr1);
-    mem = (uint8_t*)ptr1;
+    void *base;
+    uint32_t size;
+    volatile lengthyProgress *progress;
+    // Read-write mapping: Monitor and the shell follow the loop below through it
+    openSharedSegment("progress", &base, &size);
+    progress = (volatile lengthyProgress *)base;
     while(true)
     {
         lock(resource);
+        // The block is only accessible between the allocate and the free
+        SVCmallocFromHeap(5000 * sizeof(uint8_t), (void *)&ptr1);
+        mem = (uint8_t*)ptr1;
+        if (mem == 0)
+        {
+            // No room in the heap right now, try again later
+            unlock(resource);
+            sleep(100);
+            continue;
+        }
         for (i = 0; i < 5000; i++)
         {
             partOfLengthyFn();
             mem[i] = i % 256;
+            if (progress != 0)
+                progress->index = i + 1;
         }
-        setPinValue(RED_LED, !getPinValue(RED_LED));
+        if (progress != 0)
+            progress->passes++;
         SVCfreeToHeap(mem);
         unlock(resource);
     }
@@ -303,3 +312,32 @@ void important(void)
         unlock(resource);
     }
 }
+
+// Follows LengthyFn through a read-only mapping of the "progress" segment and
+// toggles the red LED each time it fills a buffer
+// "progress write" in the shell makes it store to the segment, which the MPU
+// refuses with a fault
+void monitor(void)
+{
+    void *base;
+    uint32_t size;
+    uint32_t passes = 0;
+    volatile lengthyProgress *progress;
+    openSharedSegment("progress", &base, &size);
+    progress = (volatile lengthyProgress *)base;
+    while(true)
+    {
+        sleep(100);
+        if (progress == 0)
+            continue;
+        if (progress->passes != passes)
+        {
+            passes = progress->passes;
+            setPinValue(RED_LED, !getPinValue(RED_LED));
+        }
+        if (progress->writeRequest != 0)
+        {
+            progress->writeRequest = 0;     // Faults: Monitor may only read the segment
+        }
+    }
+}
@@ -11,6 +11,14 @@
 #ifndef TASKS_H_
 #define TASKS_H_
 
+// Progress of LengthyFn, published in the "progress" shared segment
+typedef struct _lengthyProgress
+{
+    uint32_t passes;                // buffers filled since startup
+    uint32_t index;                 // bytes written to the current buffer
+    uint32_t writeRequest;          // set by the shell, Monitor tries to clear it
+} lengthyProgress;
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
@@ -26,10 +34,13 @@ void flash4Hz(void);
 void oneshot(void);
 void partOfLengthyFn(void);
 void lengthyFn(void);
+void SVCmallocFromHeap(uint32_t size_in_bytes, void *ptr);
+void SVCfreeToHeap(void* ptr);
 void readKeys(void);
 void debounce(void);
 void uncooperative(void);
 void errant(void);
 void important(void);
+void monitor(void);
 
 #endif
@@ -11,7 +11,13 @@
 MEMORY
 {
     FLASH (RX) : origin = 0x00000000, length = 0x00040000
-    SRAM (RWX) : origin = 0x20000000, length = 0x00008000
+    /* Kernel RAM: the only SRAM the linker may fill. The heap managed by     */
+    /* heap.c starts at 0x20001000, so kernel data that outgrows the first    */
+    /* 4 KB fails to link instead of overlapping task memory.                 */
+    /* Budget with MAX_TASKS = 12: .kernel 512 + .stack 512 (STACK_SIZE in    */
+    /* .cproject) + .data/.bss 2998 = 4022 bytes, leaving 74 for the RTS.     */
+    SRAM (RWX) : origin = 0x20000000, length = 0x00001000
+    HEAP (RW)  : origin = 0x20001000, length = 0x00007000
 }
 
 /* The following command line options are set as part of the CCS project.    */
@@ -35,7 +41,7 @@ SECTIONS
     .pinit  :   > FLASH
     .init_array : > FLASH
 
-    .vtable :   > 0x20000000
+    .kernel :   > 0x20000000    /* kernelData, aligned to its 512 byte size */
     .data   :   > SRAM
     .bss    :   > SRAM
     .sysmem :   > SRAM
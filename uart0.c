@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include "tm4c123gh6pm.h"
 #include "uart0.h"
+#include "kernel.h"
 
 // PortA masks
 #define UART_TX_MASK 2
@@ -75,6 +76,24 @@ void setUart0BaudRate(uint32_t baudRate, uint32_t fcyc)
                                                         // turn-on UART0
 }
 
+// Enable the RX interrupt so received bytes are moved into the UART stream buffer
+// The FIFO level interrupt batches bytes and the receive timeout flushes a partial FIFO
+void enableUart0RxInterrupt(void)
+{
+    UART0_IFLS_R = (UART0_IFLS_R & ~UART_IFLS_RX_M) | UART_IFLS_RX4_8; // interrupt at 8 bytes in the RX FIFO
+    UART0_ICR_R = UART_ICR_RXIC | UART_ICR_RTIC;
+    UART0_IM_R |= UART_IM_RXIM | UART_IM_RTIM;
+    NVIC_EN0_R |= 1 << (INT_UART0 - 16);
+}
+
+// UART0 interrupt: drain the RX FIFO into the stream buffer
+void uart0Isr(void)
+{
+    while (!(UART0_FR_R & UART_FR_RXFE))
+        streamSendFromIsr(uartRxStream, UART0_DR_R & 0xFF);
+    UART0_ICR_R = UART_ICR_RXIC | UART_ICR_RTIC;
+}
+
 // Blocking function that writes a serial character when the UART buffer is not full
 void putcUart0(char c)
 {
@@ -34,5 +34,7 @@ void putcUart0(char c);
 void putsUart0(char* str);
 char getcUart0();
 bool kbhitUart0();
+void enableUart0RxInterrupt(void);
+void uart0Isr(void);
 
 #endif